@@ -82,18 +82,17 @@ struct B2_API b2JointUserData
 //  B2_API void b2Free_Default(void* mem);
 
 /// Implement this function to use your own memory allocator.
-inline void* b2Alloc(int32 size)
-{
-    // return b2Alloc_Default(size);
-   return pd::realloc(nullptr, size);
-}
+/// Defined in src/b2_user_settings.cpp; routed through b2_allocator when it's set, otherwise clg::heap_alloc().
+void* b2Alloc(int32 size);
 
 /// If you implement b2Alloc, you should also implement this function.
-inline void b2Free(void* mem)
-{
-    // b2Free_Default(mem);
-   pd::realloc(mem, 0);
-}
+void b2Free(void* mem);
+
+namespace clg { class size_class_allocator; }
+
+/// Allocator for everything Box2D allocates; nullptr means the system heap.
+/// NOTE: Only change this while no Box2D memory is live in the current allocator.
+extern clg::size_class_allocator* b2_allocator;
 
 /// Implement this to use your own logging.
 inline void b2Log(const char* string, ...)
@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGAPPROXMATH_HPP
+#define CLGAPPROXMATH_HPP
+
+#include <bit>
+#include <cstdint>
+#include <cmath>
+#ifndef CLGMATH_HPP
+  #include "clg_math.hpp"
+#endif
+
+// Approximations of sqrt, 1/sqrt, and atan2 for hot loops that don't need libm's precision.
+// Worst case errors (measured by src/bench_approx_math.cpp over the float range used by the game):
+//
+//  rsqrt<0>        relative 3.4e-2     bit trick only
+//  rsqrt<1>        relative 1.8e-3     + one Newton-Raphson step
+//  rsqrt<2>        relative 4.7e-6     + two Newton-Raphson steps
+//  atan2_lookup    absolute 1.5e-6 rad 256 segment table, linearly interpolated
+//  atan2_poly      absolute 1.2e-5 rad Abramowitz & Stegun 4.4.49
+
+namespace clg
+{
+namespace approx
+{
+    // 1/sqrt(x) for x > 0
+    template<int newton_steps = 1>
+    inline constexpr float rsqrt(float x)
+    {
+        static_assert(newton_steps >= 0 && newton_steps <= 3, "more steps than this is slower than sqrtf");
+        const float half_x = 0.5f * x;
+        float y = std::bit_cast<float>(0x5f375a86u - (std::bit_cast<uint32_t>(x) >> 1));
+        for (int i = 0; i < newton_steps; i++)
+        {
+            y *= 1.5f - half_x * y * y;
+        }
+
+        return y;
+    }
+
+    // sqrt(x) for x >= 0
+    template<int newton_steps = 1>
+    inline constexpr float sqrt(float x)
+    {
+        return x > 0.0f ? x * rsqrt<newton_steps>(x) : 0.0f;
+    }
+
+    namespace detail
+    {
+        // atan(x) for |x| <= 1; reduced around pi/4 so the series converges quickly
+        inline constexpr double atan_series(double x)
+        {
+            double offset = 0.0;
+            if (x > 0.4142135623730950) // tan(pi/8)
+            {
+                offset = clg::trig<double>::pi / 4.0;
+                x = (x - 1.0) / (x + 1.0);
+            }
+
+            const double x_squared = x * x;
+            double power = x;
+            double sum = 0.0;
+            for (int n = 0; n < 24; n++)
+            {
+                sum += ((n & 1) ? -power : power) / (2 * n + 1);
+                power *= x_squared;
+            }
+
+            return offset + sum;
+        }
+    } // namespace detail
+
+    // atan(t) over t = [0, 1], generated at compile-time
+    template<int segment_bits>
+    class atan_lookup
+    {
+        public:
+        static constexpr int segment_count = 1 << segment_bits;
+
+        constexpr atan_lookup()
+        {
+            for (int i = 0; i <= segment_count; i++)
+            {
+                samples[i] = static_cast<float>(detail::atan_series(static_cast<double>(i) / segment_count));
+            }
+        }
+
+        // t = [0, 1]
+        constexpr float atan_unit(float t) const
+        {
+            const float position = t * segment_count;
+            int index = static_cast<int>(position);
+            index = index < segment_count ? index : segment_count - 1;
+            const float fraction = position - index;
+            return samples[index] + (samples[index + 1] - samples[index]) * fraction;
+        }
+
+        private:
+        float samples[segment_count + 1] = {};
+    };
+
+    constexpr atan_lookup<8> atan_table;
+
+    // polynomial atan(t) for t = [0, 1] (Abramowitz & Stegun 4.4.49)
+    inline constexpr float atan_unit_poly(float t)
+    {
+        const float s = t * t;
+        return t * (0.9998660f + s * (-0.3302995f + s * (0.1801410f + s * (-0.0851330f + s * 0.0208351f))));
+    }
+
+    // fold an octant result back out to (-pi, pi]
+    inline constexpr float unfold_atan2(float a, bool is_steep, bool is_x_negative, bool is_y_negative)
+    {
+        if (is_steep)
+        {
+            a = clg::trig<float>::half_pi - a;
+        }
+        if (is_x_negative)
+        {
+            a = clg::trig<float>::pi - a;
+        }
+
+        return is_y_negative ? -a : a;
+    }
+
+    template<typename unit_atan_function>
+    inline constexpr float atan2_octant(float y, float x, unit_atan_function atan_unit)
+    {
+        const float ax = x < 0.0f ? -x : x;
+        const float ay = y < 0.0f ? -y : y;
+        const bool is_steep = ay > ax;
+        const float numerator = is_steep ? ax : ay;
+        const float denominator = is_steep ? ay : ax;
+        if (0.0f == denominator)
+        {
+            return 0.0f;
+        }
+
+        return unfold_atan2(atan_unit(numerator / denominator), is_steep, x < 0.0f, y < 0.0f);
+    }
+
+    // table driven atan2
+    inline constexpr float atan2_lookup(float y, float x)
+    {
+        return atan2_octant(y, x, [](float t) { return atan_table.atan_unit(t); });
+    }
+
+    // polynomial atan2; no table
+    inline constexpr float atan2_poly(float y, float x)
+    {
+        return atan2_octant(y, x, atan_unit_poly);
+    }
+} // namespace approx
+} // namespace clg
+
+#endif // CLGAPPROXMATH_HPP
@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGARENAALLOCATOR_HPP
+#define CLGARENAALLOCATOR_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include "memory.hpp"
+
+namespace clg
+{
+    // C++20 Allocator on top of a memory_arena.
+    //
+    // Memory is released when the arena is reset() or rewound, so deallocate() does nothing. allocate()
+    // returns nullptr instead of throwing when the arena is out of room (the build has no exceptions), so
+    // only use this with containers that check for it (see containers.hpp); the std containers don't.
+    template<typename T>
+    class arena_allocator
+    {
+        template<typename> friend class arena_allocator;
+
+        public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using is_always_equal = std::false_type;
+
+        explicit arena_allocator(memory_arena& source_arena, const char* allocation_tag = nullptr)
+            : p_arena(&source_arena)
+            , tag(allocation_tag)
+        {
+        }
+
+        template<typename U>
+        arena_allocator(const arena_allocator<U>& other)
+            : p_arena(other.p_arena)
+            , tag(other.tag)
+        {
+        }
+
+        // returns nullptr when the arena is too full
+        T* allocate(size_t count)
+        {
+            if (count > static_cast<size_t>(-1) / sizeof(T))
+            {
+                return nullptr;
+            }
+
+            // check up front so running out isn't reported as an error by the arena
+            const auto byte_count = count * sizeof(T);
+            if (byte_count + alignof(T) - 1 > p_arena->get_free_count())
+            {
+                return nullptr;
+            }
+
+            return static_cast<T*>(p_arena->aligned_alloc<static_cast<int>(alignof(T))>(byte_count, tag));
+        }
+
+        void deallocate(T*, size_t)
+        {
+        }
+
+        memory_arena& arena() const
+        {
+            return *p_arena;
+        }
+
+        template<typename U>
+        bool operator==(const arena_allocator<U>& rhs) const
+        {
+            return p_arena == rhs.p_arena;
+        }
+
+        private:
+        memory_arena* p_arena;
+        const char* tag;
+    };
+} // namespace clg
+
+#endif // CLGARENAALLOCATOR_HPP
@@ -0,0 +1,239 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGARENASNAPSHOT_HPP
+#define CLGARENASNAPSHOT_HPP
+
+#include "memory.hpp"
+
+namespace clg
+{
+    // Saves the tail of a memory_arena to a file and loads it back in a single read.
+    //
+    // Everything allocated after begin() is the snapshot. Pointers into it have to be registered so they
+    // can be stored as offsets and patched on load: add_pointer() for pointer fields inside the snapshot,
+    // add_root() for pointers outside it (e.g. globals). Roots must be registered in the same order
+    // before both save() and load().
+    // NOTE: Only plain data is safe to snapshot; nothing with a vtable or pointers outside the arena.
+    class arena_snapshot
+    {
+        static constexpr uint32_t magic = 0x53474c43; // "CLGS"
+        static constexpr uint32_t null_offset = 0xffffffffu;
+
+        struct file_header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t data_size;
+            uint32_t base_misalignment;     // base address modulo base_alignment, so alignments survive
+            uint32_t relocation_count;
+            uint32_t root_count;
+        };
+
+        public:
+        static constexpr int max_relocation_count = 256;
+        static constexpr int max_root_count = 32;
+        static constexpr int base_alignment = pd::PageAlignment;
+
+        // version: bump whenever the code building the snapshot's contents changes
+        explicit arena_snapshot(uint32_t content_version)
+            : version(content_version)
+            , p_base(nullptr)
+            , relocation_count(0)
+            , root_count(0)
+        {
+        }
+
+        // the snapshot starts at the arena's current position
+        void begin(memory_arena& arena)
+        {
+            p_base = static_cast<uint8_t*>(arena.get_marker().p_position);
+            relocation_count = 0;
+        }
+
+        // register a pointer field inside the snapshot that points into the snapshot (or is nullptr)
+        bool add_pointer(void** p_field)
+        {
+            if (relocation_count == max_relocation_count)
+            {
+                pd::error("ERROR: too many arena snapshot relocations");
+                return false;
+            }
+
+            relocations[relocation_count++] = p_field;
+            return true;
+        }
+
+        // register a pointer outside the snapshot that points into the snapshot (or is nullptr)
+        template<typename T>
+        bool add_root(T** p_root)
+        {
+            if (root_count == max_root_count)
+            {
+                pd::error("ERROR: too many arena snapshot roots");
+                return false;
+            }
+
+            roots[root_count++] = reinterpret_cast<void**>(p_root);
+            return true;
+        }
+
+        // write everything allocated in the arena since begin()
+        bool save(const memory_arena& arena, const char* path)
+        {
+            assert(nullptr != p_base);
+            auto p_end = static_cast<uint8_t*>(arena.get_marker().p_position);
+
+            file_header header;
+            header.magic = magic;
+            header.version = version;
+            header.data_size = static_cast<uint32_t>(p_end - p_base);
+            header.base_misalignment = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(p_base) & (base_alignment - 1));
+            header.relocation_count = relocation_count;
+            header.root_count = root_count;
+
+            auto file = pd::open(path, kFileWrite);
+            if (nullptr == file)
+            {
+                pd::logToConsole("ERROR: failed to open %s: %s", path, pd::geterr());
+                return false;
+            }
+
+            // pointers inside the data are swapped for offsets while it's written, then put back
+            uint32_t relocation_offsets[max_relocation_count];
+            for (int i = 0; i < relocation_count; i++)
+            {
+                auto p_field = relocations[i];
+                assert(reinterpret_cast<uint8_t*>(p_field) >= p_base && reinterpret_cast<uint8_t*>(p_field + 1) <= p_end);
+                relocation_offsets[i] = static_cast<uint32_t>(reinterpret_cast<uint8_t*>(p_field) - p_base);
+                *reinterpret_cast<uintptr_t*>(p_field) = to_offset(*p_field, p_end);
+            }
+
+            uint32_t root_offsets[max_root_count];
+            for (int i = 0; i < root_count; i++)
+            {
+                root_offsets[i] = to_offset(*roots[i], p_end);
+            }
+
+            const bool is_written =
+                write(file, &header, sizeof(header)) &&
+                write(file, p_base, header.data_size) &&
+                write(file, relocation_offsets, sizeof(uint32_t) * relocation_count) &&
+                write(file, root_offsets, sizeof(uint32_t) * root_count);
+            pd::close(file);
+
+            for (int i = 0; i < relocation_count; i++)
+            {
+                const auto offset = static_cast<uint32_t>(*reinterpret_cast<uintptr_t*>(relocations[i]));
+                *relocations[i] = null_offset == offset ? nullptr : p_base + offset;
+            }
+
+            if (!is_written)
+            {
+                pd::logToConsole("ERROR: failed to write %s: %s", path, pd::geterr());
+            }
+
+            return is_written;
+        }
+
+        // read a snapshot into the arena and point the roots at it
+        // returns false (and leaves the arena as it was) when the file is missing or was saved by other code
+        bool load(memory_arena& arena, const char* path)
+        {
+            auto file = pd::open(path, kFileReadData);
+            if (nullptr == file)
+            {
+                return false;
+            }
+
+            file_header header;
+            const bool is_header_valid =
+                static_cast<int>(sizeof(header)) == pd::read(file, &header, sizeof(header)) &&
+                magic == header.magic &&
+                version == header.version &&
+                header.relocation_count <= max_relocation_count &&
+                root_count == static_cast<int>(header.root_count);
+            if (!is_header_valid)
+            {
+                pd::logToConsole("%s is out of date", path);
+                pd::close(file);
+                return false;
+            }
+
+            // the data and both offset tables come in with one read; the tables are released afterwards
+            const auto table_size = sizeof(uint32_t) * (header.relocation_count + header.root_count);
+            const auto read_size = header.data_size + table_size;
+            const auto saved = arena.get_marker();
+            if (base_alignment + header.base_misalignment + read_size > arena.get_free_count())
+            {
+                pd::logToConsole("ERROR: not enough arena space to load %s", path);
+                pd::close(file);
+                return false;
+            }
+
+            const auto p_aligned = static_cast<uint8_t*>(arena.aligned_alloc<base_alignment>(header.base_misalignment + read_size, CLG_ARENA_TAG("snapshot")));
+            uint8_t* const p_data = p_aligned + header.base_misalignment;
+            const bool is_read = nullptr != p_aligned && static_cast<int>(read_size) == pd::read(file, p_data, read_size);
+            pd::close(file);
+            if (!is_read)
+            {
+                pd::logToConsole("ERROR: failed to read %s", path);
+                arena.rewind(saved);
+                return false;
+            }
+
+            // NOTE: the tables follow the data directly, so they may be unaligned
+            const auto p_relocation_offsets = p_data + header.data_size;
+            const auto p_root_offsets = p_relocation_offsets + sizeof(uint32_t) * header.relocation_count;
+            for (uint32_t i = 0; i < header.relocation_count; i++)
+            {
+                uint32_t field_offset;
+                memcpy(&field_offset, p_relocation_offsets + sizeof(uint32_t) * i, sizeof(field_offset));
+                auto p_field = reinterpret_cast<uintptr_t*>(p_data + field_offset);
+                const auto offset = static_cast<uint32_t>(*p_field);
+                *reinterpret_cast<void**>(p_field) = null_offset == offset ? nullptr : p_data + offset;
+            }
+
+            for (int i = 0; i < root_count; i++)
+            {
+                uint32_t offset;
+                memcpy(&offset, p_root_offsets + sizeof(uint32_t) * i, sizeof(offset));
+                *roots[i] = null_offset == offset ? nullptr : p_data + offset;
+            }
+
+            arena.rewind({ p_data + header.data_size });
+            p_base = p_data;
+            return true;
+        }
+
+        private:
+        uint32_t to_offset(const void* ptr, const uint8_t* p_end) const
+        {
+            if (nullptr == ptr)
+            {
+                return null_offset;
+            }
+
+            const auto p = static_cast<const uint8_t*>(ptr);
+            assert(p >= p_base && p <= p_end);
+            return static_cast<uint32_t>(p - p_base);
+        }
+
+        static bool write(SDFile* file, const void* p_data, size_t size)
+        {
+            return 0 == size || static_cast<int>(size) == pd::write(file, p_data, size);
+        }
+
+        uint32_t version;
+        uint8_t* p_base;
+        void** relocations[max_relocation_count];
+        void** roots[max_root_count];
+        int relocation_count;
+        int root_count;
+    };
+} // namespace clg
+
+#endif // CLGARENASNAPSHOT_HPP
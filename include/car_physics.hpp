@@ -10,6 +10,17 @@
 #include "pd.hpp"
 #include "box2d/box2d.h"
 #include "clg-math/clg_vector.hpp"
+#include "approx_math.hpp"
+
+// Set to 0 to use Box2D's full precision Length() and Normalize() in the tire model.
+#ifndef CLG_APPROX_CAR_MATH
+  #define CLG_APPROX_CAR_MATH 1
+#endif
+
+// Newton-Raphson steps taken by the approximate 1/sqrt (see approx_math.hpp for the error bounds).
+#ifndef CLG_APPROX_CAR_MATH_STEPS
+  #define CLG_APPROX_CAR_MATH_STEPS 1
+#endif
 
 // TODO:
 //  Add standard braking.
@@ -29,6 +40,11 @@ constexpr float absoluteAirPressure = 101.325f; // kPa
 constexpr float specificGasConstant = 287.058f; // for dry air (J/kg*K))
 constexpr float C2K = 273.15f;
 
+// defaults for tires on asphalt (see surface_map.hpp for other surfaces)
+constexpr float staticFrictionCoefficient = 3.5f;
+constexpr float dynamicFrictionCoefficient = 2.0f;
+constexpr float rollingResistanceCoefficient = 0.015f;
+
 inline constexpr float RecalculateMassDensityOfAir(float temperatureC, float pressurekPa)
 {
     // (absolute pressure (Pa)) / (specific gas constant * absolute temperture K)
@@ -90,7 +106,7 @@ inline constexpr float RollingResistance(float weightSupportedByTire, float coef
 
 inline constexpr float RollingResistance(float weightSupportedByTire)
 {
-    return RollingResistance(weightSupportedByTire, 0.015f);
+    return RollingResistance(weightSupportedByTire, rollingResistanceCoefficient);
 }
 
 inline constexpr float TotalDrag(float speed, float weightSupportedByTires)
@@ -114,18 +130,68 @@ inline constexpr float TireFrictionForce(float weightSupportedByTire, float coef
     return coefficientOfFriction * weightSupportedByTire;
 }
 
+inline constexpr float TireDynamicFrictionForce(float weightSupportedByTire, float coefficientOfFriction)
+{
+    return TireFrictionForce(weightSupportedByTire, coefficientOfFriction);
+}
+
 inline constexpr float TireDynamicFrictionForce(float weightSupportedByTire)
 {
-    return 2.0f * weightSupportedByTire;
+    return TireDynamicFrictionForce(weightSupportedByTire, dynamicFrictionCoefficient);
+}
+
+inline constexpr float TireStaticFrictionForce(float weightSupportedByTire, float coefficientOfFriction)
+{
+    return TireFrictionForce(weightSupportedByTire, coefficientOfFriction);
 }
 
 inline constexpr float TireStaticFrictionForce(float weightSupportedByTire)
 {
-    return 3.5f * weightSupportedByTire;
+    return TireStaticFrictionForce(weightSupportedByTire, staticFrictionCoefficient);
+}
+
+// Weight moved from the front axle to the back while accelerating forward (negative while braking).
+// The suspension is treated as rigid, so this is the steady state transfer.
+inline constexpr float LongitudinalLoadTransfer(float totalWeight, float forwardAcceleration, float centerOfMassHeight, float wheelbase)
+{
+    return totalWeight * (forwardAcceleration / gravitationalAcceleration) * centerOfMassHeight / wheelbase;
+}
+
+// weight moved from the right side to the left while accelerating to the right (e.g. turning right)
+inline constexpr float LateralLoadTransfer(float totalWeight, float rightwardAcceleration, float centerOfMassHeight, float trackWidth)
+{
+    return totalWeight * (rightwardAcceleration / gravitationalAcceleration) * centerOfMassHeight / trackWidth;
 }
 
 } // namespace Formula
 
+inline float Length(const b2Vec2& v)
+{
+#if CLG_APPROX_CAR_MATH
+    return approx::sqrt<CLG_APPROX_CAR_MATH_STEPS>(v.LengthSquared());
+#else
+    return v.Length();
+#endif
+}
+
+// same contract as b2Vec2::Normalize(); returns the original length
+inline float Normalize(b2Vec2& v)
+{
+#if CLG_APPROX_CAR_MATH
+    const auto lengthSquared = v.LengthSquared();
+    if (lengthSquared < b2_epsilon * b2_epsilon)
+    {
+        return 0.0f;
+    }
+
+    const auto invLength = approx::rsqrt<CLG_APPROX_CAR_MATH_STEPS>(lengthSquared);
+    v *= invLength;
+    return lengthSquared * invLength;
+#else
+    return v.Normalize();
+#endif
+}
+
 class Tire
 {
 public:
@@ -138,6 +204,9 @@ public:
         Down    = 0x8
     };
 
+    // IsSkidding (skid marks and sound) turns on once a sliding tire's lateral force passes this many times its dynamic friction
+    static constexpr float skidMarkThreshold = 60.0f;
+
     Tire()
         : m_body(nullptr)
         , Speed(0.0f)
@@ -173,19 +242,28 @@ public:
         return result;
     }
 
+    // NOTE: The game doesn't call updateFriction() or updateDrive(); vehicle_system::apply_friction() and
+    //  apply_drive() run the same math for every tire at once. They're the reference those loops follow.
     // NOTE: deltaTime is in seconds
     void updateFriction(float weightSupportedByTire, float deltaTime)
+    {
+        updateFriction(weightSupportedByTire, weightSupportedByTire, deltaTime, formula::staticFrictionCoefficient, formula::dynamicFrictionCoefficient);
+    }
+
+    // loadOnTire is the weight pressing the tire into the road after load transfer; it sets the grip, while
+    // weightSupportedByTire is the share of the car's mass the tire has to stop sliding sideways
+    void updateFriction(float weightSupportedByTire, float loadOnTire, float deltaTime, float staticFrictionCoefficient, float dynamicFrictionCoefficient)
     {
         const auto lateralVelocity = getLateralVelocity();
         const auto kgPerSecond = (weightSupportedByTire / formula::gravitationalAcceleration) / deltaTime;
         const b2Vec2 lateralForce(lateralVelocity.x * kgPerSecond, lateralVelocity.y * kgPerSecond);
 
         // Start with static coefficient of friction
-        const auto frictionalForceMagnitude = formula::TireStaticFrictionForce(weightSupportedByTire);
+        const auto frictionalForceMagnitude = formula::TireStaticFrictionForce(loadOnTire, staticFrictionCoefficient);
 
-        const auto lateralForceMagnitude = lateralForce.Length();
+        const auto lateralForceMagnitude = clg::Length(lateralForce);
         auto lateralVelocityNormal = lateralVelocity;
-        lateralVelocityNormal.Normalize();
+        clg::Normalize(lateralVelocityNormal);
 
         // if (the tire shouldn't be skidding)
         if (frictionalForceMagnitude > lateralForceMagnitude)
@@ -203,12 +281,11 @@ public:
         else // else (the tire is skidding)
         {
             // skid using dynamic coefficient of friction
-            const auto dynamicFrictionalForceMagnitude = formula::TireDynamicFrictionForce(weightSupportedByTire);
+            const auto dynamicFrictionalForceMagnitude = formula::TireDynamicFrictionForce(loadOnTire, dynamicFrictionCoefficient);
             lateralVelocityNormal *= -dynamicFrictionalForceMagnitude;
             m_body->ApplyForceToCenter(lateralVelocityNormal, true);
 
-            // TODO: where does the 60.0f come from??? -- threashold for making noise
-            if (!IsSkidding && lateralForceMagnitude > dynamicFrictionalForceMagnitude * 60.0f)
+            if (!IsSkidding && lateralForceMagnitude > dynamicFrictionalForceMagnitude * skidMarkThreshold)
             {
                 IsSkidding = true;
                 // skidSound.Play();
@@ -256,6 +333,9 @@ public:
         m_body->ApplyForceToCenter(currentForwardNormal, true);
     }
 
+    float getMaxBackwardSpeed() const { return m_maxBackwardSpeed; }
+    float getMaxDriveForce() const { return m_maxDriveForce; }
+
     b2Body* m_body;
     float Speed;
     //AudioSource skidSound;
@@ -287,6 +367,38 @@ public:
     static constexpr float totalWeight = 2240.0f; // kg
     static constexpr float wheelWeight = 15.0f; // kg per tire
 
+    // body dimensions in meters (see Create())
+    static constexpr float chassisHalfWidth = 1.143f;
+    static constexpr float chassisHalfLength = 2.286f;
+    static constexpr float tireHalfWidth = 0.1225f; // 245/35R21 tires (245mm wide; 245mm * 0.35 sidewall; fit 21inch rims)
+    static constexpr float tireHalfLength = 0.309575f; // 533.4mm rim + (0.35 * 245mm tires) == 533.4mm + 85.75mm == 619.15mm == 0.61915m
+    static constexpr float halfTrack = 0.84455f; // 66.5inch track and 116.5inch wheelbase
+    static constexpr float halfWheelbase = 1.47955f;
+    static constexpr float maxSteeringAngle = 40.0f; // degrees either way
+    static constexpr float maxSteeringTorque = 500.0f; // Nm
+    static constexpr float centerOfMassHeight = 0.46f; // m
+
+    // NOTE: Smooths the measured acceleration; stands in for the suspension taking time to settle.
+    static constexpr float loadTransferSmoothing = 0.2f;
+
+    // NOTE: This is a mostly arbitrary turning rate.
+    //  The original idea was to take about half a second to transition from
+    //  steering wheel full-left to full-right.
+    static constexpr float steeringRate = 160.0f * 4.0f; // degrees per second
+    static constexpr float steeringReturnRate = 10.0f; // with no input, the wheels turn back at this times their angle (per second)
+
+    // The handling values that can be changed per car at runtime (e.g. by src/tuning_sweep.cpp); the
+    // defaults are the constants above.
+    struct Tuning
+    {
+        float backTireMaxDriveForce = Car::backTireMaxDriveForce;
+        float frontTireMaxDriveForce = Car::frontTireMaxDriveForce;
+        float maxBackwardSpeed = Car::maxBackwardSpeed;
+        float frictionScale = 1.0f; // multiplies the road's static and dynamic friction coefficients
+        float steeringRate = Car::steeringRate;
+        float steeringReturnRate = Car::steeringReturnRate;
+    };
+
     //JointMotor2D powerSteering = new JointMotor2D();
 
     b2Body* m_body;
@@ -295,16 +407,100 @@ public:
     b2RevoluteJoint* frJoint;
 
     float Speed = 0.0f;
+    float TireLoads[4]; // kg pressing each tire into the road
 
     Car()
         : m_body(nullptr)
         , flJoint(nullptr)
         , frJoint(nullptr)
         , Speed(0.0f)
+        , TireLoads{ totalWeight / 4.0f, totalWeight / 4.0f, totalWeight / 4.0f, totalWeight / 4.0f }
+        , m_wheelbase(0.0f)
+        , m_trackWidth(0.0f)
+        , m_tuning()
+    {
+    }
+
+    // create the bodies, fixtures and joints of a car centered on position, then Initialize() with them
+    void Create(b2World& world, const b2Vec2& position)
     {
+        Create(world, position, Tuning());
+    }
+
+    void Create(b2World& world, const b2Vec2& position, const Tuning& tuning)
+    {
+        b2Body* carBody;
+        {
+            b2BodyDef carBodyDef;
+            carBodyDef.type = b2BodyType::b2_dynamicBody;
+            carBodyDef.position = position;
+            carBody = world.CreateBody(&carBodyDef);
+        }
+        // car fixture setup
+        {
+            b2PolygonShape carBox;
+            carBox.SetAsBox(chassisHalfWidth, chassisHalfLength);
+            b2FixtureDef carFixture;
+            carFixture.shape = &carBox;
+            carFixture.density = 1.0f; // the mass is set below
+            carBody->CreateFixture(&carFixture);
+        }
+        // car mass
+        {
+            auto massData = carBody->GetMassData();
+            massData.mass = (totalWeight - 4.0f * wheelWeight) / formula::gravitationalAcceleration;
+            carBody->SetMassData(&massData);
+        }
+        // tire bodies
+        const b2Vec2 tirePos[4] =
+        {
+            b2Vec2(-halfTrack,  halfWheelbase), b2Vec2(halfTrack,  halfWheelbase),
+            b2Vec2(-halfTrack, -halfWheelbase), b2Vec2(halfTrack, -halfWheelbase)
+        };
+        b2Body* tireBodies[4];
+        {
+            b2BodyDef tireBodyDef;
+            tireBodyDef.type = b2BodyType::b2_dynamicBody;
+            b2PolygonShape tireBox;
+            tireBox.SetAsBox(tireHalfWidth, tireHalfLength);
+            b2FixtureDef tireFixture;
+            tireFixture.shape = &tireBox;
+            tireFixture.density = 1.0f;
+            for (int i = 0; i < 4; i++)
+            {
+                tireBodyDef.position = position + tirePos[i];
+                tireBodies[i] = world.CreateBody(&tireBodyDef);
+                tireBodies[i]->CreateFixture(&tireFixture);
+                // tire mass
+                {
+                    auto massData = tireBodies[i]->GetMassData();
+                    massData.mass = wheelWeight / formula::gravitationalAcceleration;
+                    tireBodies[i]->SetMassData(&massData);
+                }
+            }
+        }
+        // front wheel pivot joints
+        b2RevoluteJoint* wheelJoint[2];
+        for (int i = 0; i < 2; i++)
+        {
+            b2RevoluteJointDef jointDef;
+            jointDef.enableLimit = true;
+            jointDef.lowerAngle = clg::to_radians(-maxSteeringAngle);
+            jointDef.upperAngle = clg::to_radians(maxSteeringAngle);
+            jointDef.maxMotorTorque = maxSteeringTorque;
+            jointDef.Initialize(carBody, tireBodies[i], position + tirePos[i]);
+            wheelJoint[i] = static_cast<b2RevoluteJoint*>(world.CreateJoint(&jointDef));
+        }
+
+        Initialize(carBody, tireBodies, wheelJoint, tuning);
     }
 
     void Initialize(b2Body* body, b2Body* tireBodies[4], b2RevoluteJoint* wheelJoint[2])
+    {
+        Initialize(body, tireBodies, wheelJoint, Tuning());
+    }
+
+    void Initialize(b2Body* body, b2Body* tireBodies[4], b2RevoluteJoint* wheelJoint[2], const Tuning& tuning)
     {
         m_body = body;
         flJoint = wheelJoint[0];
@@ -314,16 +510,24 @@ public:
             m_tires[i].Initialize(tireBodies[i]);
         }
 
-        flJoint->SetMaxMotorTorque(500.0f);
-        frJoint->SetMaxMotorTorque(500.0f);
-        m_tires[0].setCharacteristics(maxBackwardSpeed, frontTireMaxDriveForce / 2.0f);
-        m_tires[1].setCharacteristics(maxBackwardSpeed, frontTireMaxDriveForce / 2.0f);
-        m_tires[2].setCharacteristics(maxBackwardSpeed, backTireMaxDriveForce / 2.0f);
-        m_tires[3].setCharacteristics(maxBackwardSpeed, backTireMaxDriveForce / 2.0f);
+        flJoint->SetMaxMotorTorque(maxSteeringTorque);
+        frJoint->SetMaxMotorTorque(maxSteeringTorque);
+        setTuning(tuning);
+
+        // measured from where the tires were placed
+        const auto frontLeft = m_body->GetLocalPoint(m_tires[static_cast<int>(TireIndex::FrontLeft)].m_body->GetPosition());
+        const auto frontRight = m_body->GetLocalPoint(m_tires[static_cast<int>(TireIndex::FrontRight)].m_body->GetPosition());
+        const auto backLeft = m_body->GetLocalPoint(m_tires[static_cast<int>(TireIndex::BackLeft)].m_body->GetPosition());
+        m_wheelbase = frontLeft.y - backLeft.y;
+        m_trackWidth = frontRight.x - frontLeft.x;
+        resetLoadTransfer();
 
         // Debug.Log("Total Drag: " + formula::TotalDrag(0.0f, totalWeight));
     }
 
+    // NOTE: Not game code; the game (and src/tuning_sweep.cpp) runs every car through vehicle_system,
+    //  which calls updateLoadTransfer() and updateSteering() below. This is the one car reference its
+    //  batched loops follow.
     // TODO: The steering input should maybe be handled before the physics are
     //  computed...
     void update(Tire::ControlState controlState, float deltaTime)
@@ -331,23 +535,99 @@ public:
         // m_body->drag = formula::AerodynamicDrag(m_body->velocity.magnitude);
         {
             auto velocityNormal = m_body->GetLinearVelocity();
-            const auto currentSpeed = velocityNormal.Normalize();
+            const auto currentSpeed = clg::Normalize(velocityNormal);
             velocityNormal *= -formula::AerodynamicDrag(currentSpeed);
             m_body->ApplyForceToCenter(velocityNormal, true);
         }
 
+        updateLoadTransfer(deltaTime);
+
         auto totalSpeed = 0.0f;
-        for (auto& tire : m_tires)
+        for (unsigned int i = 0; i < array_count(m_tires); i++)
         {
             // NOTE: Drive force (the tire pushing against the road) should be
             //  calculated alongside friction so that burnout may be simulated.
-            tire.updateFriction(totalWeight / clg::array_count(m_tires), deltaTime);
-            tire.updateDrive(controlState, formula::RollingResistance(totalWeight / 4.0f));
+            auto& tire = m_tires[i];
+            tire.updateFriction(totalWeight / clg::array_count(m_tires), TireLoads[i], deltaTime,
+                formula::staticFrictionCoefficient * m_tuning.frictionScale, formula::dynamicFrictionCoefficient * m_tuning.frictionScale);
+            tire.updateDrive(controlState, formula::RollingResistance(TireLoads[i]));
 
             totalSpeed += tire.Speed;
         }
         Speed = totalSpeed / clg::array_count(m_tires);
 
+        updateSteering(controlState);
+    }
+
+    // Share the weight between the tires by the chassis' acceleration since the last call.
+    void updateLoadTransfer(float deltaTime)
+    {
+        const auto& velocity = m_body->GetLinearVelocity();
+        const auto acceleration = (1.0f / deltaTime) * (velocity - m_previousVelocity);
+        m_previousVelocity = velocity;
+
+        // in the chassis' space: +x is right and +y is forward
+        const auto localAcceleration = m_body->GetLocalVector(acceleration);
+        m_acceleration += loadTransferSmoothing * (localAcceleration - m_acceleration);
+
+        const auto longitudinal = 0.5f * formula::LongitudinalLoadTransfer(totalWeight, m_acceleration.y, centerOfMassHeight, m_wheelbase);
+        const auto lateral = 0.5f * formula::LateralLoadTransfer(totalWeight, m_acceleration.x, centerOfMassHeight, m_trackWidth);
+        const auto staticLoad = totalWeight / 4.0f;
+        TireLoads[static_cast<int>(TireIndex::FrontLeft)] = staticLoad - longitudinal + lateral;
+        TireLoads[static_cast<int>(TireIndex::FrontRight)] = staticLoad - longitudinal - lateral;
+        TireLoads[static_cast<int>(TireIndex::BackLeft)] = staticLoad + longitudinal + lateral;
+        TireLoads[static_cast<int>(TireIndex::BackRight)] = staticLoad + longitudinal - lateral;
+
+        // a tire can't pull the car down; it just lifts
+        for (auto& load : TireLoads)
+        {
+            load = load < 0.0f ? 0.0f : load;
+        }
+    }
+
+    // what updateLoadTransfer() carries from one call to the next
+    struct LoadTransferState
+    {
+        b2Vec2 previousVelocity;
+        b2Vec2 acceleration;
+    };
+
+    LoadTransferState getLoadTransferState() const { return { m_previousVelocity, m_acceleration }; }
+
+    void setLoadTransferState(const LoadTransferState& state)
+    {
+        m_previousVelocity = state.previousVelocity;
+        m_acceleration = state.acceleration;
+    }
+
+    // start measuring the acceleration over (e.g. after the car was moved)
+    void resetLoadTransfer()
+    {
+        m_previousVelocity = m_body->GetLinearVelocity();
+        m_acceleration.SetZero();
+        for (auto& load : TireLoads)
+        {
+            load = totalWeight / 4.0f;
+        }
+    }
+
+    float getWheelbase() const { return m_wheelbase; }
+    float getTrackWidth() const { return m_trackWidth; }
+
+    // NOTE: vehicle_system copies what its kinematic model needs when the car is added.
+    void setTuning(const Tuning& tuning)
+    {
+        m_tuning = tuning;
+        m_tires[0].setCharacteristics(m_tuning.maxBackwardSpeed, m_tuning.frontTireMaxDriveForce / 2.0f);
+        m_tires[1].setCharacteristics(m_tuning.maxBackwardSpeed, m_tuning.frontTireMaxDriveForce / 2.0f);
+        m_tires[2].setCharacteristics(m_tuning.maxBackwardSpeed, m_tuning.backTireMaxDriveForce / 2.0f);
+        m_tires[3].setCharacteristics(m_tuning.maxBackwardSpeed, m_tuning.backTireMaxDriveForce / 2.0f);
+    }
+
+    const Tuning& getTuning() const { return m_tuning; }
+
+    void updateSteering(Tire::ControlState controlState)
+    {
         // Update steering controls with user input
         ///////////////////////////////////////////
 
@@ -356,9 +636,7 @@ public:
         //  hinge joint property, or the value should be pushed from code
         //  overwriting the hinge joint instance's limits.
 
-        // NOTE: This is a mostly arbitrary turning rate.
-        //  The original idea was to take about half a second to transition from
-        //  steering wheel full-left to full-right.
+        // NOTE: The turning rate comes from the tuning (see steeringRate).
         // TODO: Test with 360 controller and keyboard to get the feel "right".
 
         switch (static_cast<Tire::ControlState>(
@@ -369,7 +647,7 @@ public:
                 {
                     if (flJoint->GetJointAngle() > -40.0f)
                     {
-                        const auto radiansPerSecond = clg::to_radians(-160.0f) * 4;
+                        const auto radiansPerSecond = clg::to_radians(-m_tuning.steeringRate);
                         flJoint->SetMotorSpeed(radiansPerSecond);
                         frJoint->SetMotorSpeed(radiansPerSecond);
                         flJoint->EnableMotor(true);
@@ -382,7 +660,7 @@ public:
                 {
                     if (flJoint->GetJointAngle() < 40.0f)
                     {
-                        const auto radiansPerSecond = clg::to_radians(160.0f) * 4;
+                        const auto radiansPerSecond = clg::to_radians(m_tuning.steeringRate);
                         flJoint->SetMotorSpeed(radiansPerSecond);
                         frJoint->SetMotorSpeed(radiansPerSecond);
                         flJoint->EnableMotor(true);
@@ -397,7 +675,7 @@ public:
 
         // When there is no steering input, drift the wheels back to center
         ///////////////////////////////////////////////////////////////////
-        const auto radiansPerSecond = flJoint->GetJointAngle() * 10.0f;
+        const auto radiansPerSecond = -flJoint->GetJointAngle() * m_tuning.steeringReturnRate;
 
         if (flJoint->GetJointAngle() < -0.1f)
         {
@@ -420,6 +698,13 @@ public:
         flJoint->EnableMotor(false);
         frJoint->EnableMotor(false);
     }
+
+private:
+    float m_wheelbase;
+    float m_trackWidth;
+    b2Vec2 m_previousVelocity;
+    b2Vec2 m_acceleration; // smoothed, in the chassis' space
+    Tuning m_tuning;
 }; // class Car
 
 } // namespace clg
@@ -0,0 +1,487 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGCONTAINERS_HPP
+#define CLGCONTAINERS_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include "arena_allocator.hpp"
+
+// Containers for game code that never touch the heap or throw.
+//
+// Every operation that needs memory reports failure through its return value (false or nullptr) and leaves
+// the container unchanged. Storage comes from an allocator (usually an arena_allocator); memory is given
+// back when the arena is reset, so containers must not outlive their arena.
+
+namespace clg
+{
+    // Contiguous growable array.
+    // NOTE: Growing moves the elements to a new block and abandons the old one in the arena; reserve()
+    //       up front where the final size is known.
+    template<typename T, typename Allocator = arena_allocator<T>>
+    class vector
+    {
+        public:
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        explicit vector(const Allocator& source_allocator)
+            : allocator(source_allocator)
+            , p_data(nullptr)
+            , count(0)
+            , capacity_count(0)
+        {
+        }
+
+        vector(vector&& other)
+            : allocator(other.allocator)
+            , p_data(other.p_data)
+            , count(other.count)
+            , capacity_count(other.capacity_count)
+        {
+            other.p_data = nullptr;
+            other.count = 0;
+            other.capacity_count = 0;
+        }
+
+        vector(const vector&) = delete;
+        vector& operator=(const vector&) = delete;
+
+        ~vector()
+        {
+            clear();
+            allocator.deallocate(p_data, capacity_count);
+        }
+
+        // make room for at least new_capacity elements
+        bool reserve(size_t new_capacity)
+        {
+            if (new_capacity <= capacity_count)
+            {
+                return true;
+            }
+
+            auto p_new_data = allocator.allocate(new_capacity);
+            if (nullptr == p_new_data)
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                new (p_new_data + i) T(std::move(p_data[i]));
+                p_data[i].~T();
+            }
+
+            allocator.deallocate(p_data, capacity_count);
+            p_data = p_new_data;
+            capacity_count = new_capacity;
+            return true;
+        }
+
+        // returns nullptr when out of memory
+        template<typename... Params>
+        T* emplace_back(Params&&... args)
+        {
+            if (count == capacity_count && !reserve(0 == capacity_count ? 8 : capacity_count * 2))
+            {
+                return nullptr;
+            }
+
+            return new (p_data + count++) T(std::forward<Params>(args)...);
+        }
+
+        bool push_back(const T& value) { return nullptr != emplace_back(value); }
+        bool push_back(T&& value) { return nullptr != emplace_back(std::move(value)); }
+
+        void pop_back()
+        {
+            assert(count > 0);
+            p_data[--count].~T();
+        }
+
+        // remove an element by moving the last one into its place; doesn't keep the order
+        void swap_remove(size_t index)
+        {
+            assert(index < count);
+            if (index != count - 1)
+            {
+                p_data[index] = std::move(p_data[count - 1]);
+            }
+
+            pop_back();
+        }
+
+        void clear()
+        {
+            while (count > 0)
+            {
+                p_data[--count].~T();
+            }
+        }
+
+        T& operator[](size_t index) { assert(index < count); return p_data[index]; }
+        const T& operator[](size_t index) const { assert(index < count); return p_data[index]; }
+        T& back() { return (*this)[count - 1]; }
+        const T& back() const { return (*this)[count - 1]; }
+
+        T* data() { return p_data; }
+        const T* data() const { return p_data; }
+        iterator begin() { return p_data; }
+        iterator end() { return p_data + count; }
+        const_iterator begin() const { return p_data; }
+        const_iterator end() const { return p_data + count; }
+
+        size_t size() const { return count; }
+        size_t capacity() const { return capacity_count; }
+        bool empty() const { return 0 == count; }
+
+        private:
+        Allocator allocator;
+        T* p_data;
+        size_t count;
+        size_t capacity_count;
+    };
+
+    // Fixed-capacity FIFO queue. The oldest element is index 0.
+    template<typename T, typename Allocator = arena_allocator<T>>
+    class ring_buffer
+    {
+        public:
+        using value_type = T;
+
+        explicit ring_buffer(const Allocator& source_allocator)
+            : allocator(source_allocator)
+            , p_data(nullptr)
+            , head(0)
+            , count(0)
+            , capacity_count(0)
+        {
+        }
+
+        ring_buffer(const ring_buffer&) = delete;
+        ring_buffer& operator=(const ring_buffer&) = delete;
+
+        ~ring_buffer()
+        {
+            clear();
+            allocator.deallocate(p_data, capacity_count);
+        }
+
+        // allocate room for capacity elements; may only be done once
+        bool initialize(size_t capacity)
+        {
+            assert(nullptr == p_data);
+            p_data = allocator.allocate(capacity);
+            if (nullptr == p_data)
+            {
+                return false;
+            }
+
+            capacity_count = capacity;
+            return true;
+        }
+
+        // returns false when full
+        bool push_back(const T& value)
+        {
+            if (full())
+            {
+                return false;
+            }
+
+            new (p_data + physical_index(count)) T(value);
+            count++;
+            return true;
+        }
+
+        // when full, the oldest element is dropped to make room
+        void push_back_overwrite(const T& value)
+        {
+            if (full())
+            {
+                pop_front();
+            }
+
+            push_back(value);
+        }
+
+        // construct in place, dropping the oldest element when full
+        template<typename... Params>
+        T& emplace_back_overwrite(Params&&... args)
+        {
+            if (full())
+            {
+                pop_front();
+            }
+
+            const auto p = new (p_data + physical_index(count)) T(std::forward<Params>(args)...);
+            count++;
+            return *p;
+        }
+
+        void pop_front()
+        {
+            assert(count > 0);
+            p_data[head].~T();
+            head = head + 1 == capacity_count ? 0 : head + 1;
+            count--;
+        }
+
+        // remove the newest element
+        void pop_back()
+        {
+            assert(count > 0);
+            p_data[physical_index(--count)].~T();
+        }
+
+        void clear()
+        {
+            while (count > 0)
+            {
+                pop_front();
+            }
+
+            head = 0;
+        }
+
+        T& operator[](size_t index) { assert(index < count); return p_data[physical_index(index)]; }
+        const T& operator[](size_t index) const { assert(index < count); return p_data[physical_index(index)]; }
+        T& front() { return (*this)[0]; }
+        const T& front() const { return (*this)[0]; }
+        T& back() { return (*this)[count - 1]; }
+        const T& back() const { return (*this)[count - 1]; }
+
+        size_t size() const { return count; }
+        size_t capacity() const { return capacity_count; }
+        bool empty() const { return 0 == count; }
+        bool full() const { return count == capacity_count; }
+
+        private:
+        size_t physical_index(size_t index) const
+        {
+            const auto i = head + index;
+            return i < capacity_count ? i : i - capacity_count;
+        }
+
+        Allocator allocator;
+        T* p_data;
+        size_t head;
+        size_t count;
+        size_t capacity_count;
+    };
+
+    // Fixed-capacity hash map with open addressing (linear probing) in one flat array.
+    // Removal shifts the following entries back, so there are no tombstones and lookups stay short.
+    // NOTE: Keep the load factor under ~75%; insert() fails once every slot is taken.
+    template<typename Key, typename Value, typename Hash = std::hash<Key>,
+             typename Allocator = arena_allocator<std::pair<Key, Value>>>
+    class flat_hash_map
+    {
+        public:
+        using key_type = Key;
+        using mapped_type = Value;
+        using value_type = std::pair<Key, Value>;
+
+        explicit flat_hash_map(const Allocator& source_allocator)
+            : slot_allocator(source_allocator)
+            , flag_allocator(source_allocator)
+            , p_slots(nullptr)
+            , p_is_used(nullptr)
+            , slot_mask(0)
+            , hash_shift(32)
+            , count(0)
+        {
+        }
+
+        flat_hash_map(const flat_hash_map&) = delete;
+        flat_hash_map& operator=(const flat_hash_map&) = delete;
+
+        ~flat_hash_map()
+        {
+            clear();
+        }
+
+        // allocate room for capacity entries (rounded up to a power of two); may only be done once
+        bool initialize(size_t capacity)
+        {
+            assert(nullptr == p_slots);
+            size_t slot_count = 8;
+            int slot_bits = 3;
+            while (slot_count < capacity)
+            {
+                slot_count *= 2;
+                slot_bits++;
+            }
+
+            p_slots = slot_allocator.allocate(slot_count);
+            p_is_used = flag_allocator.allocate(slot_count);
+            if (nullptr == p_slots || nullptr == p_is_used)
+            {
+                p_slots = nullptr;
+                p_is_used = nullptr;
+                return false;
+            }
+
+            std::fill(p_is_used, p_is_used + slot_count, static_cast<uint8_t>(0));
+            slot_mask = slot_count - 1;
+            hash_shift = 32 - slot_bits;
+            return true;
+        }
+
+        // insert or assign; returns nullptr when the map is full
+        Value* insert(const Key& key, const Value& value)
+        {
+            const auto index = find_slot(key);
+            if (index > slot_mask)
+            {
+                return nullptr;
+            }
+
+            if (p_is_used[index])
+            {
+                p_slots[index].second = value;
+            }
+            else
+            {
+                new (p_slots + index) value_type(key, value);
+                p_is_used[index] = 1;
+                count++;
+            }
+
+            return &p_slots[index].second;
+        }
+
+        // returns nullptr when the key isn't in the map
+        Value* find(const Key& key)
+        {
+            const auto index = find_slot(key);
+            return index <= slot_mask && p_is_used[index] ? &p_slots[index].second : nullptr;
+        }
+
+        const Value* find(const Key& key) const
+        {
+            return const_cast<flat_hash_map*>(this)->find(key);
+        }
+
+        bool contains(const Key& key) const
+        {
+            return nullptr != find(key);
+        }
+
+        // returns false when the key isn't in the map
+        bool erase(const Key& key)
+        {
+            auto index = find_slot(key);
+            if (index > slot_mask || !p_is_used[index])
+            {
+                return false;
+            }
+
+            // shift back later entries of the probe run that would become unreachable
+            auto next = index;
+            while (true)
+            {
+                next = (next + 1) & slot_mask;
+                if (!p_is_used[next])
+                {
+                    break;
+                }
+
+                const auto home = home_slot(p_slots[next].first);
+                const bool is_home_in_gap = index <= next ? (home <= index || home > next) : (home <= index && home > next);
+                if (is_home_in_gap)
+                {
+                    p_slots[index] = std::move(p_slots[next]);
+                    index = next;
+                }
+            }
+
+            p_slots[index].~value_type();
+            p_is_used[index] = 0;
+            count--;
+            return true;
+        }
+
+        void clear()
+        {
+            for (size_t i = 0; nullptr != p_slots && i <= slot_mask; i++)
+            {
+                if (p_is_used[i])
+                {
+                    p_slots[i].~value_type();
+                    p_is_used[i] = 0;
+                }
+            }
+
+            count = 0;
+        }
+
+        // visit every entry as function(const Key&, Value&)
+        template<typename Function>
+        void for_each(Function function)
+        {
+            for (size_t i = 0; nullptr != p_slots && i <= slot_mask; i++)
+            {
+                if (p_is_used[i])
+                {
+                    function(static_cast<const Key&>(p_slots[i].first), p_slots[i].second);
+                }
+            }
+        }
+
+        size_t size() const { return count; }
+        size_t capacity() const { return nullptr != p_slots ? slot_mask + 1 : 0; }
+        bool empty() const { return 0 == count; }
+
+        private:
+        using flag_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<uint8_t>;
+
+        size_t home_slot(const Key& key) const
+        {
+            // Fibonacci hashing spreads out weak hashes (e.g. std::hash of an integer is the integer)
+            const auto h = static_cast<uint32_t>(Hash()(key)) * 2654435769u;
+            return static_cast<size_t>(h >> hash_shift);
+        }
+
+        // the slot holding key, or the empty slot where it would go; > slot_mask when the map is full
+        size_t find_slot(const Key& key) const
+        {
+            if (nullptr == p_slots)
+            {
+                return slot_mask + 1;
+            }
+
+            auto index = home_slot(key);
+            for (size_t probe = 0; probe <= slot_mask; probe++)
+            {
+                if (!p_is_used[index] || p_slots[index].first == key)
+                {
+                    return index;
+                }
+
+                index = (index + 1) & slot_mask;
+            }
+
+            return slot_mask + 1;
+        }
+
+        Allocator slot_allocator;
+        flag_allocator_type flag_allocator;
+        value_type* p_slots;
+        uint8_t* p_is_used;
+        size_t slot_mask;
+        int hash_shift;
+        size_t count;
+    };
+} // namespace clg
+
+#endif // CLGCONTAINERS_HPP
@@ -0,0 +1,211 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGDECALLAYER_HPP
+#define CLGDECALLAYER_HPP
+
+#include "pd.hpp"
+#include "memory.hpp"
+
+namespace clg
+{
+    // A persistent, world-space, 1-bit per pixel layer for marks that accumulate over time (e.g. skid marks).
+    // The world is split into tiles of 32x32 pixels; memory for a tile is only taken from the arena the first
+    // time something is stamped into it. Compositing touches only the tiles overlapping the screen, so the
+    // per-frame cost doesn't grow with the number of marks.
+    class decal_layer
+    {
+        public:
+        static constexpr int tile_size = 32; // pixels; each tile row is exactly one 32-bit word
+        static constexpr int tile_shift = 5;
+
+        decal_layer()
+            : p_tiles(nullptr)
+            , p_arena(nullptr)
+            , origin_x(0)
+            , origin_y(0)
+            , tile_column_count(0)
+            , tile_row_count(0)
+            , allocated_tile_count(0)
+            , is_arena_exhausted(false)
+        {
+        }
+
+        // covers world pixels [left, left + width) x [bottom, bottom + height)
+        // NOTE: The tile table is allocated up-front; the tiles themselves are allocated on demand.
+        bool initialize(memory_arena* p_tile_arena, int left, int bottom, int width, int height)
+        {
+            tile_column_count = (width + tile_size - 1) >> tile_shift;
+            tile_row_count = (height + tile_size - 1) >> tile_shift;
+            const auto table_byte_count = sizeof(uint32_t*) * tile_column_count * tile_row_count;
+            p_tiles = static_cast<uint32_t**>(p_tile_arena->aligned_alloc<alignof(uint32_t*)>(table_byte_count, CLG_ARENA_TAG("decal tile table")));
+            if (nullptr == p_tiles)
+            {
+                tile_column_count = 0;
+                tile_row_count = 0;
+                return false;
+            }
+
+            std::fill(p_tiles, p_tiles + tile_column_count * tile_row_count, nullptr);
+            p_arena = p_tile_arena;
+            origin_x = left;
+            origin_y = bottom;
+            allocated_tile_count = 0;
+            is_arena_exhausted = false;
+            return true;
+        }
+
+        // set a single world pixel; pixels outside the layer's bounds are ignored
+        void set_pixel(int x, int y)
+        {
+            x -= origin_x;
+            y -= origin_y;
+            if (x < 0 || y < 0)
+            {
+                return;
+            }
+
+            const auto p_tile = get_or_allocate_tile(x >> tile_shift, y >> tile_shift);
+            if (nullptr == p_tile)
+            {
+                return;
+            }
+
+            p_tile[y & (tile_size - 1)] |= 0x80000000u >> (x & (tile_size - 1));
+        }
+
+        // stamp a filled disc centered on a world pixel
+        void stamp(int x, int y, int radius)
+        {
+            const int radius_squared = radius * radius;
+            for (int j = -radius; j <= radius; j++)
+            {
+                for (int i = -radius; i <= radius; i++)
+                {
+                    if (i * i + j * j <= radius_squared)
+                    {
+                        set_pixel(x + i, y + j);
+                    }
+                }
+            }
+        }
+
+        // OR the visible part of the layer into a display frame buffer
+        // camera_x, camera_y: world pixel drawn at the bottom-left corner of the display
+        void composite(uint32_t* const frame_buffer, int camera_x, int camera_y) const
+        {
+            constexpr int words_per_row = pd::LcdRowStride / sizeof(uint32_t);
+
+            // find the range of tiles overlapping the display
+            const int view_left = camera_x - origin_x;
+            const int view_bottom = camera_y - origin_y;
+            const int first_column = std::max(0, view_left >> tile_shift);
+            const int first_row = std::max(0, view_bottom >> tile_shift);
+            const int last_column = std::min(tile_column_count - 1, (view_left + pd::LcdWidth - 1) >> tile_shift);
+            const int last_row = std::min(tile_row_count - 1, (view_bottom + pd::LcdHeight - 1) >> tile_shift);
+
+            for (int tile_y = first_row; tile_y <= last_row; tile_y++)
+            {
+                for (int tile_x = first_column; tile_x <= last_column; tile_x++)
+                {
+                    const auto p_tile = p_tiles[tile_y * tile_column_count + tile_x];
+                    if (nullptr == p_tile)
+                    {
+                        continue;
+                    }
+
+                    const int screen_x = (tile_x << tile_shift) - view_left;
+                    const int screen_y = (tile_y << tile_shift) - view_bottom;
+                    const int begin_row = std::max(0, -screen_y);
+                    const int end_row = std::min(tile_size, pd::LcdHeight - screen_y);
+
+                    // a tile row spans at most two display words
+                    const int word_index = screen_x >> tile_shift; // NOTE: arithmetic shift; -1 when partially off the left
+                    const int bit_offset = screen_x & (tile_size - 1);
+
+                    for (int row = begin_row; row < end_row; row++)
+                    {
+                        const uint32_t bits = p_tile[row];
+                        if (0 == bits)
+                        {
+                            continue;
+                        }
+
+                        uint32_t* const p_line = frame_buffer + FlipRow(screen_y + row) * words_per_row;
+                        if (word_index >= 0)
+                        {
+                            p_line[word_index] |= to_frame_word(bits >> bit_offset);
+                        }
+                        if (0 != bit_offset && word_index + 1 < words_per_row)
+                        {
+                            p_line[word_index + 1] |= to_frame_word(bits << (tile_size - bit_offset));
+                        }
+                    }
+                }
+            }
+        }
+
+        // number of tiles that have been allocated out of the arena
+        int get_allocated_tile_count() const
+        {
+            return allocated_tile_count;
+        }
+
+        private:
+        static constexpr int FlipRow(const int y)
+        {
+            return (pd::LcdHeight - 1) - y;
+        }
+
+        // tile words keep the leftmost pixel in the MSB; the display wants MSB-ordered bytes
+        static inline uint32_t to_frame_word(uint32_t bits)
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return __builtin_bswap32(bits);
+#else
+            return bits;
+#endif
+        }
+
+        uint32_t* get_or_allocate_tile(int tile_x, int tile_y)
+        {
+            if (tile_x >= tile_column_count || tile_y >= tile_row_count)
+            {
+                return nullptr;
+            }
+
+            auto& p_tile = p_tiles[tile_y * tile_column_count + tile_x];
+            if (nullptr == p_tile && !is_arena_exhausted)
+            {
+                // check up front so running out isn't reported as an error by the arena; once it's full, stop
+                // asking and keep the existing marks
+                constexpr size_t tile_byte_count = tile_size * sizeof(uint32_t);
+                if (tile_byte_count + alignof(uint32_t) - 1 > p_arena->get_free_count())
+                {
+                    is_arena_exhausted = true;
+                    return nullptr;
+                }
+
+                p_tile = static_cast<uint32_t*>(p_arena->aligned_alloc<alignof(uint32_t)>(tile_byte_count, CLG_ARENA_TAG("decal tiles")));
+                std::fill(p_tile, p_tile + tile_size, 0u);
+                allocated_tile_count++;
+            }
+
+            return p_tile;
+        }
+
+        uint32_t** p_tiles;
+        memory_arena* p_arena;
+        int origin_x;
+        int origin_y;
+        int tile_column_count;
+        int tile_row_count;
+        int allocated_tile_count;
+        bool is_arena_exhausted;
+    };
+} // namespace clg
+
+#endif // CLGDECALLAYER_HPP
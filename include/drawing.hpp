@@ -224,79 +224,33 @@ namespace clg
 #endif // TARGET_PLAYDATE
     }
 
-    template<typename base_type, int fractional_bit_count>
-    inline constexpr base_type make_fixed_point(float number)
-    {
-        constexpr int base_bit_count = sizeof(base_type) * 8;
-        constexpr int fractional_part_multiplier = 1 << fractional_bit_count;
-        static_assert(fractional_bit_count < base_bit_count, "too many fractional bits");
-        assert(number < powf(2, base_bit_count - fractional_bit_count - 1) && number > -powf(2, base_bit_count - fractional_bit_count - 1) - 1.0f);
-
-        const base_type result = number * fractional_part_multiplier;
-        return result;
-    }
-
-    template<typename base_type, int fractional_bit_count>
-    inline constexpr base_type get_integer_part(base_type fixed_point)
-    {
-        const base_type result = fixed_point >> fractional_bit_count;
-        return result;
-    }
-
-    template<typename base_type, int fractional_bit_count>
-    inline constexpr float get_fractional_part(base_type fixed_point)
-    {
-        constexpr int fractional_part_multiplier = 1 << fractional_bit_count;
-        const auto result = static_cast<float>(fixed_point) / fractional_part_multiplier;
-        return result;
-    }
-
     inline constexpr point rotate_counter_clockwise(float cosTheta, float sinTheta, const point& p)
     {
         const point result(p[0] * cosTheta - p[1] * sinTheta, p[0] * sinTheta + p[1] * cosTheta);
         return result;
     }
 
-    // scale -> rotate -> translate
-    void BlitTransformedAlphaTexturedRectangle(
-        const point& dst,               // rectangle destination on screen (centered on this coordinate)
-        const sizev& scale,             // scale on screen
-        const float angle,              // rotation in radians
+    // rasterize a rectangle whose screen-space corners were already transformed (e.g. by transform_quad_batch())
+    void BlitTransformedAlphaTexturedQuad(
+        const point& lb,                // left-bottom corner on screen
+        const point& rb,                // right-bottom corner on screen
+        const point& lt,                // left-top corner on screen
+        const point& rt,                // right-top corner on screen
+        const float cosTheta,           // cosine of the rotation
+        const float sinTheta,           // sine of the rotation
+        const sizev& dstSize,           // scaled size on screen
         const recti& src,               // start of the rectangle in pixel buffer; width and height of the rectangle in the pixel buffer
-        const point& srcCenter,         // center of the source image (the point it renders around & rotates around)
         const uint8_t* const pixels,    // pixel buffer
         const int srcLinePitch,         // line pitch of the pixel buffer
         const bool drawDebugOutline     // draw debug outline box
     )
     {
-        const auto srcSize = src.size();
-        if (srcSize.width <= 0 || srcSize.height <= 0 || scale.width <= 0.0f || scale.height <= 0.0f) // if (the scale in any dimension == 0)
+        if (dstSize.width <= 0.0f || dstSize.height <= 0.0f || src.width() <= 0 || src.height() <= 0)
         {
             return;
         }
 
-        // get scaled dst size
-        const sizev srcSizef(srcSize);
-        const sizev dstSize(srcSizef * scale);
-
-        // get scaled dst center point
-        const point dstScaledCenter(srcCenter * static_cast<point>(scale));
-
-        // get vertices of the scaled src in screen-space, centered about the origin
-        const point olb(-dstScaledCenter.x, -dstScaledCenter.y);
-        const point orb(dstSize.width - dstScaledCenter.x, -dstScaledCenter.y);
-        const point olt(-dstScaledCenter.x, dstSize.height - dstScaledCenter.y);
-        const point ort(dstSize.width - dstScaledCenter.x, dstSize.height - dstScaledCenter.y);
-
-        // bite off those trig functions
-        const auto cosTheta = cos_lookup(angle);
-        const auto sinTheta = sin_lookup(angle);
-
-        // get vertices of scaled, rotated, and translated src in screen-space
-        const point lb(rotate_counter_clockwise(cosTheta, sinTheta, olb) + dst);
-        const point rb(rotate_counter_clockwise(cosTheta, sinTheta, orb) + dst);
-        const point lt(rotate_counter_clockwise(cosTheta, sinTheta, olt) + dst);
-        const point rt(rotate_counter_clockwise(cosTheta, sinTheta, ort) + dst);
+        const sizev srcSizef(src.size());
         vec2 srcScanlineNormal(cosTheta, -sinTheta);
 
         // get first and last scanline containing transformed dst rectangle
@@ -378,12 +332,12 @@ namespace clg
             const float scanlineRelativeProgress = clamp(((begin_column + 0.5f) - first_x_intercept) * invDstScanlineLength);
 
             vec2 srcPos(srcStart + srcScanlineNormal * (srcScanlineLength * scanlineRelativeProgress));
-            int32_t srcPosX = make_fixed_point<int32_t, 24>(srcPos.x);
-            int32_t srcPosY = make_fixed_point<int32_t, 24>(srcPos.y);
+            auto srcPosX = fixed8_24::from_float(srcPos.x);
+            auto srcPosY = fixed8_24::from_float(srcPos.y);
 
             const vec2 srcStep(srcScanlineNormal * (srcScanlineLength * invDstScanlineLength));
-            const int32_t srcStepX = make_fixed_point<int32_t, 24>(srcStep.x);
-            const int32_t srcStepY = make_fixed_point<int32_t, 24>(srcStep.y);
+            const auto srcStepX = fixed8_24::from_float(srcStep.x);
+            const auto srcStepY = fixed8_24::from_float(srcStep.y);
 
             for (int column_x = begin_column;;) // ???ms (/wo FetchTextureIndex() or WritePixel())
             {
@@ -393,8 +347,8 @@ namespace clg
                 const auto fragment = FetchTextureIndex( // ~5ms (/wo WritePixel ?? - ??ms) (/w WritePixe() 16 - 17.9ms)
                     pixels,
                     srcLinePitch,
-                    get_integer_part<int32_t, 24>(srcPosX),
-                    get_integer_part<int32_t, 24>(srcPosY)
+                    srcPosX.to_int(),
+                    srcPosY.to_int()
                     );
 
                 // write pixel
@@ -445,6 +399,51 @@ namespace clg
 #endif // TARGET_PLAYDATE
     }
 
+    // scale -> rotate -> translate
+    void BlitTransformedAlphaTexturedRectangle(
+        const point& dst,               // rectangle destination on screen (centered on this coordinate)
+        const sizev& scale,             // scale on screen
+        const float angle,              // rotation in radians
+        const recti& src,               // start of the rectangle in pixel buffer; width and height of the rectangle in the pixel buffer
+        const point& srcCenter,         // center of the source image (the point it renders around & rotates around)
+        const uint8_t* const pixels,    // pixel buffer
+        const int srcLinePitch,         // line pitch of the pixel buffer
+        const bool drawDebugOutline     // draw debug outline box
+    )
+    {
+        const auto srcSize = src.size();
+        if (srcSize.width <= 0 || srcSize.height <= 0 || scale.width <= 0.0f || scale.height <= 0.0f) // if (the scale in any dimension == 0)
+        {
+            return;
+        }
+
+        // get scaled dst size
+        const sizev srcSizef(srcSize);
+        const sizev dstSize(srcSizef * scale);
+
+        // get scaled dst center point
+        const point dstScaledCenter(srcCenter * static_cast<point>(scale));
+
+        // get vertices of the scaled src in screen-space, centered about the origin
+        const point olb(-dstScaledCenter.x, -dstScaledCenter.y);
+        const point orb(dstSize.width - dstScaledCenter.x, -dstScaledCenter.y);
+        const point olt(-dstScaledCenter.x, dstSize.height - dstScaledCenter.y);
+        const point ort(dstSize.width - dstScaledCenter.x, dstSize.height - dstScaledCenter.y);
+
+        // bite off those trig functions
+        const auto rotation = sincos(angle);
+        const auto cosTheta = rotation.c;
+        const auto sinTheta = rotation.s;
+
+        // get vertices of scaled, rotated, and translated src in screen-space
+        const point lb(rotate_counter_clockwise(cosTheta, sinTheta, olb) + dst);
+        const point rb(rotate_counter_clockwise(cosTheta, sinTheta, orb) + dst);
+        const point lt(rotate_counter_clockwise(cosTheta, sinTheta, olt) + dst);
+        const point rt(rotate_counter_clockwise(cosTheta, sinTheta, ort) + dst);
+
+        BlitTransformedAlphaTexturedQuad(lb, rb, lt, rt, cosTheta, sinTheta, dstSize, src, pixels, srcLinePitch, drawDebugOutline);
+    }
+
     inline void ClearFrameBuffer()
     {
         std::fill(pFrameBuf, pFrameBuf + pd::LcdRowStride / sizeof(clg::pFrameBuf[0]) * pd::LcdHeight, 0);
@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGFIXEDPOINT_HPP
+#define CLGFIXEDPOINT_HPP
+
+#include <cassert>
+#include <compare>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace clg
+{
+    namespace detail
+    {
+        // integer type with twice the bits; used for intermediate products and quotients
+        template<typename T> struct wider;
+        template<> struct wider<int8_t> { using type = int16_t; };
+        template<> struct wider<int16_t> { using type = int32_t; };
+        template<> struct wider<int32_t> { using type = int64_t; };
+        template<> struct wider<uint8_t> { using type = uint16_t; };
+        template<> struct wider<uint16_t> { using type = uint32_t; };
+        template<> struct wider<uint32_t> { using type = uint64_t; };
+
+        template<typename T, typename W>
+        inline constexpr T saturate(W value)
+        {
+            constexpr W lowest = static_cast<W>(std::numeric_limits<T>::lowest());
+            constexpr W highest = static_cast<W>(std::numeric_limits<T>::max());
+            return static_cast<T>(value < lowest ? lowest : (value > highest ? highest : value));
+        }
+    } // namespace detail
+
+    // Binary fixed-point number stored in base_type with fractional_bit_count bits right of the point.
+    // NOTE: The plain operators wrap on overflow just like the base integer type; use the *_sat() functions
+    //       where clamping is required.
+    template<typename base_type, int fractional_bit_count>
+    class fixed
+    {
+        static_assert(std::is_integral_v<base_type>, "fixed-point base type must be an integer");
+        static_assert(sizeof(base_type) <= sizeof(int32_t), "no wider type available for intermediate results");
+        static_assert(fractional_bit_count >= 0 && fractional_bit_count < static_cast<int>(sizeof(base_type) * 8), "too many fractional bits");
+
+        public:
+        using raw_type = base_type;
+        using wide_type = typename detail::wider<base_type>::type;
+        static constexpr int fraction_bits = fractional_bit_count;
+        static constexpr wide_type raw_one = static_cast<wide_type>(1) << fractional_bit_count; // NOTE: may not fit in base_type (e.g. Q1.15)
+        static constexpr base_type fraction_mask = static_cast<base_type>(raw_one - 1);
+
+        constexpr fixed()
+            : raw(0)
+        {
+        }
+
+        static constexpr fixed from_raw(base_type value)
+        {
+            fixed result;
+            result.raw = value;
+            return result;
+        }
+
+        static constexpr fixed from_int(base_type number)
+        {
+            return from_raw(static_cast<base_type>(number << fractional_bit_count));
+        }
+
+        // NOTE: truncates toward zero
+        static constexpr fixed from_float(float number)
+        {
+            assert(number < max_float && number >= lowest_float);
+            return from_raw(static_cast<base_type>(number * raw_one));
+        }
+
+        static constexpr fixed from_float_sat(float number)
+        {
+            if (number >= max_float)
+                return from_raw(std::numeric_limits<base_type>::max());
+            if (number < lowest_float)
+                return from_raw(std::numeric_limits<base_type>::lowest());
+            return from_raw(static_cast<base_type>(number * raw_one));
+        }
+
+        constexpr base_type raw_value() const
+        {
+            return raw;
+        }
+
+        // rounds toward negative infinity
+        constexpr base_type to_int() const
+        {
+            return raw >> fractional_bit_count;
+        }
+
+        constexpr float to_float() const
+        {
+            return static_cast<float>(raw) * (1.0f / raw_one);
+        }
+
+        constexpr fixed fractional_part() const
+        {
+            return from_raw(raw & fraction_mask);
+        }
+
+        // arithmetic
+        constexpr fixed operator+(fixed rhs) const { return from_raw(static_cast<base_type>(raw + rhs.raw)); }
+        constexpr fixed operator-(fixed rhs) const { return from_raw(static_cast<base_type>(raw - rhs.raw)); }
+        constexpr fixed operator-() const { return from_raw(static_cast<base_type>(-raw)); }
+
+        constexpr fixed operator*(fixed rhs) const
+        {
+            return from_raw(static_cast<base_type>((static_cast<wide_type>(raw) * rhs.raw) >> fractional_bit_count));
+        }
+
+        constexpr fixed operator/(fixed rhs) const
+        {
+            assert(0 != rhs.raw);
+            return from_raw(static_cast<base_type>((static_cast<wide_type>(raw) << fractional_bit_count) / rhs.raw));
+        }
+
+        // scale by an integer; no shift required
+        constexpr fixed operator*(base_type rhs) const { return from_raw(static_cast<base_type>(raw * rhs)); }
+        constexpr fixed operator/(base_type rhs) const { return from_raw(static_cast<base_type>(raw / rhs)); }
+
+        constexpr fixed& operator+=(fixed rhs) { return *this = *this + rhs; }
+        constexpr fixed& operator-=(fixed rhs) { return *this = *this - rhs; }
+        constexpr fixed& operator*=(fixed rhs) { return *this = *this * rhs; }
+        constexpr fixed& operator/=(fixed rhs) { return *this = *this / rhs; }
+        constexpr fixed& operator*=(base_type rhs) { return *this = *this * rhs; }
+        constexpr fixed& operator/=(base_type rhs) { return *this = *this / rhs; }
+
+        // comparison
+        constexpr bool operator==(const fixed&) const = default;
+        constexpr auto operator<=>(const fixed&) const = default;
+
+        // saturating arithmetic
+        constexpr fixed add_sat(fixed rhs) const
+        {
+            return from_raw(detail::saturate<base_type>(static_cast<wide_type>(raw) + rhs.raw));
+        }
+
+        constexpr fixed sub_sat(fixed rhs) const
+        {
+            return from_raw(detail::saturate<base_type>(static_cast<wide_type>(raw) - rhs.raw));
+        }
+
+        constexpr fixed mul_sat(fixed rhs) const
+        {
+            return from_raw(detail::saturate<base_type>((static_cast<wide_type>(raw) * rhs.raw) >> fractional_bit_count));
+        }
+
+        // full precision product; nothing is shifted out or overflows
+        constexpr fixed<wide_type, fractional_bit_count * 2> mul_wide(fixed rhs) const
+        {
+            return fixed<wide_type, fractional_bit_count * 2>::from_raw(static_cast<wide_type>(raw) * rhs.raw);
+        }
+
+        private:
+        static constexpr float max_float = static_cast<float>(std::numeric_limits<base_type>::max()) / raw_one;
+        static constexpr float lowest_float = static_cast<float>(std::numeric_limits<base_type>::lowest()) / raw_one;
+
+        base_type raw;
+    };
+
+    // NOTE: fixed<int64_t, ...> results from mul_wide() only support raw access and conversions; there's no
+    //       wider type for their own arithmetic.
+    template<int fractional_bit_count>
+    class fixed<int64_t, fractional_bit_count>
+    {
+        public:
+        using raw_type = int64_t;
+        static constexpr int fraction_bits = fractional_bit_count;
+
+        static constexpr fixed from_raw(int64_t value)
+        {
+            fixed result;
+            result.raw = value;
+            return result;
+        }
+
+        constexpr int64_t raw_value() const { return raw; }
+        constexpr int64_t to_int() const { return raw >> fractional_bit_count; }
+        constexpr float to_float() const { return static_cast<float>(static_cast<double>(raw) / (static_cast<int64_t>(1) << fractional_bit_count)); }
+
+        // narrow back to a 32-bit format, saturating on overflow
+        template<typename base_type, int target_fractional_bit_count>
+        constexpr fixed<base_type, target_fractional_bit_count> narrow_sat() const
+        {
+            static_assert(target_fractional_bit_count <= fractional_bit_count, "narrowing can't add precision");
+            return fixed<base_type, target_fractional_bit_count>::from_raw(
+                detail::saturate<base_type>(raw >> (fractional_bit_count - target_fractional_bit_count)));
+        }
+
+        private:
+        int64_t raw = 0;
+    };
+
+    using fixed16_16 = fixed<int32_t, 16>;
+    using fixed8_24 = fixed<int32_t, 24>;
+    using fixed1_15 = fixed<int16_t, 15>;
+} // namespace clg
+
+#endif // CLGFIXEDPOINT_HPP
@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGHEAPTRACKER_HPP
+#define CLGHEAPTRACKER_HPP
+
+#include "pd.hpp"
+#include <cstdint>
+
+// Set to 1 to count heap traffic (global operator new/delete and Box2D's heap fallback) and report any
+// allocation made after the level finished loading. On by default in debug builds.
+#ifndef CLG_HEAP_TRACKING
+  #ifdef NDEBUG
+    #define CLG_HEAP_TRACKING 0
+  #else
+    #define CLG_HEAP_TRACKING 1
+  #endif
+#endif
+
+namespace clg
+{
+    struct heap_counts
+    {
+        uint32_t allocation_count;
+        uint32_t free_count;
+        size_t allocated_bytes;
+    };
+
+    // Counts heap calls per frame. Once mark_level_loaded() is called the game is in its steady state and
+    // every heap allocation is a violation: the first one is raised with pd::error(), the rest are counted.
+    class heap_tracker
+    {
+        public:
+        constexpr heap_tracker()
+            : frame()
+            , last_frame()
+            , total()
+            , frame_number(0)
+            , violation_count(0)
+            , is_level_loaded(false)
+        {
+        }
+
+        void record_allocation(size_t byte_count, const char* source)
+        {
+            frame.allocation_count++;
+            frame.allocated_bytes += byte_count;
+            total.allocation_count++;
+            total.allocated_bytes += byte_count;
+            if (is_level_loaded)
+            {
+                violation_count++;
+                if (1 == violation_count)
+                {
+                    pd::error("ERROR: %u byte heap allocation from %s after the level loaded (frame %u)",
+                        static_cast<unsigned>(byte_count), source, static_cast<unsigned>(frame_number));
+                }
+            }
+        }
+
+        void record_free()
+        {
+            frame.free_count++;
+            total.free_count++;
+        }
+
+        // call at the start of every frame
+        void begin_frame()
+        {
+            last_frame = frame;
+            frame = heap_counts();
+            frame_number++;
+        }
+
+        // from now on, any heap allocation is reported
+        void mark_level_loaded()
+        {
+            is_level_loaded = true;
+        }
+
+        // allow heap allocations again (e.g. while loading the next level)
+        void clear_level_loaded()
+        {
+            is_level_loaded = false;
+        }
+
+        const heap_counts& get_frame_counts() const { return frame; }
+        const heap_counts& get_last_frame_counts() const { return last_frame; }
+        const heap_counts& get_total_counts() const { return total; }
+        uint32_t get_violation_count() const { return violation_count; }
+
+        private:
+        heap_counts frame;
+        heap_counts last_frame;
+        heap_counts total;
+        uint32_t frame_number;
+        uint32_t violation_count;
+        bool is_level_loaded;
+    };
+
+#if CLG_HEAP_TRACKING
+    extern heap_tracker global_heap_tracker; // defined in pd.cpp
+#endif
+} // namespace clg
+
+#endif // CLGHEAPTRACKER_HPP
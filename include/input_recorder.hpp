@@ -0,0 +1,404 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGINPUTRECORDER_HPP
+#define CLGINPUTRECORDER_HPP
+
+#include "pd.hpp"
+#include <cstdint>
+#include <cstring>
+
+// Set CLG_INPUT_RECORDING to 1 to record every fixed update's input (and a checksum of the simulation
+// state after it) from startup on. Set CLG_INPUT_REPLAY to 1 to instead run a recording through the
+// fixed updates at startup, without drawing, and report the time it took and any divergence.
+#ifndef CLG_INPUT_RECORDING
+  #define CLG_INPUT_RECORDING 0
+#endif
+
+#ifndef CLG_INPUT_REPLAY
+  #define CLG_INPUT_REPLAY 0
+#endif
+
+#if CLG_INPUT_RECORDING && CLG_INPUT_REPLAY
+  #error "CLG_INPUT_RECORDING and CLG_INPUT_REPLAY can't both be enabled"
+#endif
+
+namespace clg
+{
+    // the input consumed by one fixed update
+    struct input_sample
+    {
+        static constexpr float crank_units_per_degree = 64.0f;
+
+        uint8_t buttons;        // PDButtons held
+        int16_t crank_change;   // in 1/64 degrees so recordings reproduce it exactly
+
+        static int16_t quantize_crank(float degrees)
+        {
+            const float units = degrees * crank_units_per_degree;
+            return static_cast<int16_t>(units > 32767.0f ? 32767.0f : (units < -32768.0f ? -32768.0f : units));
+        }
+
+        float get_crank_degrees() const { return crank_change / crank_units_per_degree; }
+        bool operator==(const input_sample&) const = default;
+    };
+
+    // running FNV-1a hash, e.g. of the simulation state
+    inline uint32_t hash_fnv1a(const void* p_data, size_t size, uint32_t hash = 2166136261u)
+    {
+        const auto p = static_cast<const uint8_t*>(p_data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ p[i]) * 16777619u;
+        }
+
+        return hash;
+    }
+
+    namespace detail
+    {
+        // Input recordings start with this header, then one run per change of input:
+        // buttons (1 byte), crank change (2 bytes, little endian), tick count (1 byte).
+        // The checksum file is one little endian uint32_t per tick.
+        struct input_file_header
+        {
+            static constexpr uint32_t current_magic = 0x49474c43; // "CLGI"
+            static constexpr uint32_t current_version = 1;
+
+            uint32_t magic;
+            uint32_t version;
+            float fixed_delta_time;
+        };
+
+        constexpr int input_run_size = 4;
+        constexpr int input_file_buffer_size = 512;
+    } // namespace detail
+
+    // Writes input samples and state checksums through small buffers, so recording costs a pd::write()
+    // every hundred or so ticks. Ticks with the same input as the last one extend its run.
+    class input_recorder
+    {
+        public:
+        input_recorder()
+            : input_file(nullptr)
+            , checksum_file(nullptr)
+            , last_sample()
+            , run_length(0)
+            , input_count(0)
+            , checksum_count(0)
+            , tick_count(0)
+        {
+        }
+
+        input_recorder(const input_recorder&) = delete;
+        input_recorder& operator=(const input_recorder&) = delete;
+
+        ~input_recorder()
+        {
+            close();
+        }
+
+        bool open(const char* input_path, const char* checksum_path, float fixed_delta_time)
+        {
+            close();
+            input_file = pd::open(input_path, kFileWrite);
+            checksum_file = pd::open(checksum_path, kFileWrite);
+            if (nullptr == input_file || nullptr == checksum_file)
+            {
+                pd::logToConsole("ERROR: failed to open the input recording: %s", pd::geterr());
+                close();
+                return false;
+            }
+
+            const detail::input_file_header header = { detail::input_file_header::current_magic, detail::input_file_header::current_version, fixed_delta_time };
+            memcpy(input_buffer, &header, sizeof(header));
+            input_count = sizeof(header);
+            checksum_count = 0;
+            run_length = 0;
+            tick_count = 0;
+            return true;
+        }
+
+        bool is_open() const
+        {
+            return nullptr != input_file;
+        }
+
+        // call once per fixed update with the input it consumed and the state it left
+        void record(const input_sample& sample, uint32_t state_checksum)
+        {
+            if (!is_open())
+            {
+                return;
+            }
+
+            if (run_length > 0 && (sample != last_sample || 0xff == run_length))
+            {
+                write_run();
+            }
+
+            last_sample = sample;
+            run_length++;
+            tick_count++;
+
+            if (checksum_count + sizeof(uint32_t) > sizeof(checksum_buffer))
+            {
+                flush_buffer(checksum_file, checksum_buffer, checksum_count);
+            }
+
+            const uint8_t bytes[sizeof(uint32_t)] =
+            {
+                static_cast<uint8_t>(state_checksum), static_cast<uint8_t>(state_checksum >> 8),
+                static_cast<uint8_t>(state_checksum >> 16), static_cast<uint8_t>(state_checksum >> 24)
+            };
+            memcpy(checksum_buffer + checksum_count, bytes, sizeof(bytes));
+            checksum_count += sizeof(bytes);
+        }
+
+        // write everything recorded so far (e.g. when the game is paused)
+        void flush()
+        {
+            if (!is_open())
+            {
+                return;
+            }
+
+            if (run_length > 0)
+            {
+                write_run();
+            }
+
+            flush_buffer(input_file, input_buffer, input_count);
+            flush_buffer(checksum_file, checksum_buffer, checksum_count);
+            pd::flush(input_file);
+            pd::flush(checksum_file);
+        }
+
+        void close()
+        {
+            flush();
+            if (nullptr != input_file)
+            {
+                pd::close(input_file);
+                input_file = nullptr;
+            }
+
+            if (nullptr != checksum_file)
+            {
+                pd::close(checksum_file);
+                checksum_file = nullptr;
+            }
+        }
+
+        uint32_t get_tick_count() const { return tick_count; }
+
+        private:
+        void write_run()
+        {
+            if (input_count + detail::input_run_size > sizeof(input_buffer))
+            {
+                flush_buffer(input_file, input_buffer, input_count);
+            }
+
+            const auto crank = static_cast<uint16_t>(last_sample.crank_change);
+            auto p = input_buffer + input_count;
+            p[0] = last_sample.buttons;
+            p[1] = static_cast<uint8_t>(crank);
+            p[2] = static_cast<uint8_t>(crank >> 8);
+            p[3] = static_cast<uint8_t>(run_length);
+            input_count += detail::input_run_size;
+            run_length = 0;
+        }
+
+        static void flush_buffer(SDFile* file, const uint8_t* p_buffer, size_t& count)
+        {
+            if (count > 0 && static_cast<int>(count) != pd::write(file, p_buffer, count))
+            {
+                pd::logToConsole("ERROR: failed to write the input recording: %s", pd::geterr());
+            }
+
+            count = 0;
+        }
+
+        SDFile* input_file;
+        SDFile* checksum_file;
+        input_sample last_sample;
+        uint32_t run_length;        // ticks with last_sample's input not yet written
+        size_t input_count;
+        size_t checksum_count;
+        uint32_t tick_count;
+        uint8_t input_buffer[detail::input_file_buffer_size];
+        uint8_t checksum_buffer[detail::input_file_buffer_size];
+    };
+
+    // Reads a recording back one tick at a time and compares the replayed state against the checksums
+    // recorded with it.
+    class input_player
+    {
+        public:
+        input_player()
+            : input_file(nullptr)
+            , checksum_file(nullptr)
+            , sample()
+            , run_remaining(0)
+            , input_begin(0)
+            , input_end(0)
+            , checksum_begin(0)
+            , checksum_end(0)
+            , tick_count(0)
+            , first_divergent_tick(-1)
+        {
+        }
+
+        input_player(const input_player&) = delete;
+        input_player& operator=(const input_player&) = delete;
+
+        ~input_player()
+        {
+            close();
+        }
+
+        // the checksum file is optional; without it check() always passes
+        bool open(const char* input_path, const char* checksum_path, float fixed_delta_time)
+        {
+            close();
+            input_file = pd::open(input_path, kFileReadData);
+            if (nullptr == input_file)
+            {
+                pd::logToConsole("ERROR: failed to open %s: %s", input_path, pd::geterr());
+                return false;
+            }
+
+            detail::input_file_header header;
+            const bool is_header_valid =
+                static_cast<int>(sizeof(header)) == pd::read(input_file, &header, sizeof(header)) &&
+                detail::input_file_header::current_magic == header.magic &&
+                detail::input_file_header::current_version == header.version;
+            if (!is_header_valid || fixed_delta_time != header.fixed_delta_time)
+            {
+                pd::logToConsole("ERROR: %s is not an input recording for this build", input_path);
+                close();
+                return false;
+            }
+
+            checksum_file = pd::open(checksum_path, kFileReadData);
+            run_remaining = 0;
+            input_begin = input_end = 0;
+            checksum_begin = checksum_end = 0;
+            tick_count = 0;
+            first_divergent_tick = -1;
+            return true;
+        }
+
+        // the input for the next tick; returns false at the end of the recording
+        bool next(input_sample& next_sample)
+        {
+            if (0 == run_remaining)
+            {
+                uint8_t run[detail::input_run_size];
+                if (nullptr == input_file || !read_bytes(input_file, input_buffer, input_begin, input_end, run, sizeof(run)))
+                {
+                    return false;
+                }
+
+                // the recorder never writes an empty run, so one means the file is truncated or corrupt
+                if (0 == run[3])
+                {
+                    pd::logToConsole("ERROR: zero length input run after tick %u; ending the replay", tick_count);
+                    return false;
+                }
+
+                sample.buttons = run[0];
+                sample.crank_change = static_cast<int16_t>(run[1] | (run[2] << 8));
+                run_remaining = run[3];
+            }
+
+            run_remaining--;
+            tick_count++;
+            next_sample = sample;
+            return true;
+        }
+
+        // compare the state left by the last tick against the recording; returns false when it differs
+        bool check(uint32_t state_checksum)
+        {
+            uint8_t bytes[sizeof(uint32_t)];
+            if (nullptr == checksum_file || !read_bytes(checksum_file, checksum_buffer, checksum_begin, checksum_end, bytes, sizeof(bytes)))
+            {
+                return true;
+            }
+
+            const uint32_t recorded = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+            if (recorded == state_checksum)
+            {
+                return true;
+            }
+
+            if (first_divergent_tick < 0)
+            {
+                first_divergent_tick = static_cast<int>(tick_count) - 1;
+            }
+
+            return false;
+        }
+
+        void close()
+        {
+            if (nullptr != input_file)
+            {
+                pd::close(input_file);
+                input_file = nullptr;
+            }
+
+            if (nullptr != checksum_file)
+            {
+                pd::close(checksum_file);
+                checksum_file = nullptr;
+            }
+        }
+
+        bool has_checksums() const { return nullptr != checksum_file; }
+        uint32_t get_tick_count() const { return tick_count; }
+        int get_first_divergent_tick() const { return first_divergent_tick; } // -1 when the replay matched
+
+        private:
+        // copy size bytes out of a buffered file; returns false at the end of the file
+        static bool read_bytes(SDFile* file, uint8_t* p_buffer, size_t& begin, size_t& end, uint8_t* p_dst, size_t size)
+        {
+            if (end - begin < size)
+            {
+                const auto remaining = end - begin;
+                memmove(p_buffer, p_buffer + begin, remaining);
+                const auto count = pd::read(file, p_buffer + remaining, detail::input_file_buffer_size - remaining);
+                begin = 0;
+                end = remaining + (count > 0 ? count : 0);
+                if (end < size)
+                {
+                    return false;
+                }
+            }
+
+            memcpy(p_dst, p_buffer + begin, size);
+            begin += size;
+            return true;
+        }
+
+        SDFile* input_file;
+        SDFile* checksum_file;
+        input_sample sample;
+        uint32_t run_remaining;     // ticks left of the current run
+        size_t input_begin;
+        size_t input_end;
+        size_t checksum_begin;
+        size_t checksum_end;
+        uint32_t tick_count;
+        int first_divergent_tick;
+        uint8_t input_buffer[detail::input_file_buffer_size];
+        uint8_t checksum_buffer[detail::input_file_buffer_size];
+    };
+} // namespace clg
+
+#endif // CLGINPUTRECORDER_HPP
@@ -8,9 +8,130 @@
 #define CLGMEMORY_HPP
 
 #include "pd.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+// Set to 1 to have every memory_arena record usage statistics (see arena_stats).
+#ifndef CLG_ARENA_INSTRUMENTATION
+  #define CLG_ARENA_INSTRUMENTATION 0
+#endif
+
+#define CLG_ARENA_STRINGIFY_DETAIL(x) #x
+#define CLG_ARENA_STRINGIFY(x) CLG_ARENA_STRINGIFY_DETAIL(x)
+
+// allocation tag naming the calling source line
+#define CLG_ARENA_CALL_SITE __FILE__ ":" CLG_ARENA_STRINGIFY(__LINE__)
+
+// allocation tag naming a category and the calling source line, so each call site gets its own total
+#define CLG_ARENA_TAG(category) category " @ " CLG_ARENA_CALL_SITE
 
 namespace clg
 {
+#if CLG_ARENA_INSTRUMENTATION
+    // usage statistics of a memory_arena; a "cycle" is the span between calls to reset() (i.e. a frame)
+    struct arena_stats
+    {
+        static constexpr int max_tag_count = 64; // including the "(other)" slot for everything that doesn't fit
+
+        struct tag_total
+        {
+            const char* tag;
+            size_t byte_count;
+            uint32_t allocation_count;
+        };
+
+        size_t peak_used_count = 0;             // high-water mark
+        size_t largest_failed_request = 0;
+        uint32_t failed_request_count = 0;
+        uint32_t reset_count = 0;
+        uint32_t cycle_allocation_count = 0;    // allocations since the last reset()
+        size_t cycle_byte_count = 0;
+        uint32_t peak_cycle_allocation_count = 0;
+        size_t peak_cycle_byte_count = 0;
+        int tag_count = 0;
+        tag_total tags[max_tag_count - 1] = {};
+        tag_total other_tag = { "(other)", 0, 0 };
+
+        void record_allocation(size_t byte_count, size_t used_count, const char* tag)
+        {
+            peak_used_count = std::max(peak_used_count, used_count);
+            cycle_allocation_count++;
+            cycle_byte_count += byte_count;
+
+            auto& total = find_tag(nullptr == tag ? "untagged" : tag);
+            total.byte_count += byte_count;
+            total.allocation_count++;
+        }
+
+        void record_failure(size_t byte_count)
+        {
+            largest_failed_request = std::max(largest_failed_request, byte_count);
+            failed_request_count++;
+        }
+
+        void record_reset()
+        {
+            peak_cycle_allocation_count = std::max(peak_cycle_allocation_count, cycle_allocation_count);
+            peak_cycle_byte_count = std::max(peak_cycle_byte_count, cycle_byte_count);
+            cycle_allocation_count = 0;
+            cycle_byte_count = 0;
+            reset_count++;
+        }
+
+        // write a human readable report to an open file
+        void write(SDFile* file, const char* arena_name, size_t total_size) const
+        {
+            char line[256];
+            auto print = [&](const char* format, auto... args)
+            {
+                const auto count = snprintf(line, sizeof(line), format, args...);
+                if (count > 0)
+                {
+                    pd::write(file, line, static_cast<unsigned int>(std::min<size_t>(count, sizeof(line) - 1)));
+                }
+            };
+
+            print("[%s]\n", arena_name);
+            print("size: %u\n", static_cast<unsigned int>(total_size));
+            print("peak used: %u\n", static_cast<unsigned int>(peak_used_count));
+            print("failed requests: %u (largest %u)\n", failed_request_count, static_cast<unsigned int>(largest_failed_request));
+            print("resets: %u\n", reset_count);
+            print("peak allocations per cycle: %u (%u bytes)\n", peak_cycle_allocation_count, static_cast<unsigned int>(peak_cycle_byte_count));
+            for (int i = 0; i < tag_count; i++)
+            {
+                print("  %s: %u bytes in %u allocations\n", tags[i].tag, static_cast<unsigned int>(tags[i].byte_count), tags[i].allocation_count);
+            }
+            if (0 != other_tag.allocation_count)
+            {
+                print("  %s: %u bytes in %u allocations\n", other_tag.tag, static_cast<unsigned int>(other_tag.byte_count), other_tag.allocation_count);
+            }
+            print("\n");
+        }
+
+        private:
+        tag_total& find_tag(const char* tag)
+        {
+            for (int i = 0; i < tag_count; i++)
+            {
+                if (tags[i].tag == tag || 0 == strcmp(tags[i].tag, tag))
+                {
+                    return tags[i];
+                }
+            }
+
+            if (tag_count == max_tag_count - 1)
+            {
+                return other_tag;
+            }
+
+            tags[tag_count].tag = tag;
+            return tags[tag_count++];
+        }
+    };
+#endif // CLG_ARENA_INSTRUMENTATION
+
     inline void* do_realloc(void* ptr, size_t byte_count)
     {
         auto result = pd::realloc(ptr, byte_count);
@@ -120,9 +241,33 @@ namespace clg
         // reset the memory arena usage tracking
         void reset()
         {
+#if CLG_ARENA_INSTRUMENTATION
+            stats.record_reset();
+#endif
             p_next = p_pool;
         }
 
+        // a saved allocation position; see rewind()
+        struct marker
+        {
+            void* p_position;
+        };
+
+        // get the current allocation position
+        marker get_marker() const
+        {
+            return { p_next };
+        }
+
+        // release everything allocated since the marker was taken
+        // NOTE: markers must be rewound in LIFO order; a marker taken before a reset() is invalid afterwards
+        void rewind(marker saved)
+        {
+            assert(static_cast<uint8_t*>(saved.p_position) >= static_cast<uint8_t*>(p_pool) &&
+                   static_cast<uint8_t*>(saved.p_position) <= static_cast<uint8_t*>(p_next));
+            p_next = saved.p_position;
+        }
+
         // get the remaining bytes in this arena
         size_t get_free_count() const
         {
@@ -136,36 +281,62 @@ namespace clg
         }
 
         // allocate bytes in this arena
-        void* alloc(size_t size)
+        // tag: names the allocation in instrumented builds (e.g. CLG_ARENA_TAG("textures")); ignored otherwise
+        void* alloc(size_t size, const char* tag = nullptr)
         {
             if (size > get_free_count())
             {
+#if CLG_ARENA_INSTRUMENTATION
+                stats.record_failure(size);
+#endif
                 pd::error("attempted to allocate more memory than arena has available");
                 return nullptr;
             }
 
             auto p_result = p_next;
             p_next = static_cast<uint8_t*>(p_next) + size;
+#if CLG_ARENA_INSTRUMENTATION
+            stats.record_allocation(size, get_used_count(), tag);
+#endif
             return p_result;
         }
 
         // allocate aligned bytes in this arena
         template<int byte_alignment>
-        void* aligned_alloc(size_t size)
+        void* aligned_alloc(size_t size, const char* tag = nullptr)
         {
             const auto p_next_aligned = static_cast<uint8_t*>(clg::align_pointer<byte_alignment>(p_next));
             const auto additional_byte_count = p_next_aligned - static_cast<uint8_t*>(p_next);
 
             if (size + additional_byte_count > get_free_count())
             {
+#if CLG_ARENA_INSTRUMENTATION
+                stats.record_failure(size + additional_byte_count);
+#endif
                 pd::error("attempted to allocate more memory than arena has available");
                 return nullptr;
             }
 
             p_next = static_cast<uint8_t*>(p_next_aligned) + size;
+#if CLG_ARENA_INSTRUMENTATION
+            stats.record_allocation(size + additional_byte_count, get_used_count(), tag);
+#endif
             return p_next_aligned;
         }
 
+#if CLG_ARENA_INSTRUMENTATION
+        const arena_stats& get_stats() const
+        {
+            return stats;
+        }
+
+        // append this arena's statistics to an open file
+        void write_stats(SDFile* file, const char* arena_name) const
+        {
+            stats.write(file, arena_name, total_size);
+        }
+#endif // CLG_ARENA_INSTRUMENTATION
+
         private:
         // only deallocates if it allocated the memory pool
         void deallocate_owned_pool()
@@ -180,6 +351,117 @@ namespace clg
         void* p_next;
         size_t total_size;
         bool is_owned;
+#if CLG_ARENA_INSTRUMENTATION
+        arena_stats stats;
+#endif
+    };
+
+    // A pair of frame arenas used alternately. Allocations made this frame stay valid through the next one,
+    // so data that has to survive exactly one frame (e.g. last frame's transforms) needs no other heap.
+    class double_buffered_arena
+    {
+        public:
+        double_buffered_arena()
+            : current_index(0)
+        {
+        }
+
+        // have each arena allocate and manage its own memory pool of up to size bytes; both get the same size
+        size_t initialize(size_t size)
+        {
+            while (0 != size)
+            {
+                auto size0 = arenas[0].initialize(size);
+                if (0 == size0)
+                {
+                    break;
+                }
+
+                // when memory is short the second arena can get less; shrink the larger one until they match
+                auto size1 = arenas[1].initialize(size0);
+                while (0 != size0 && 0 != size1 && size0 != size1)
+                {
+                    if (size0 > size1)
+                        size0 = arenas[0].initialize(size1);
+                    else
+                        size1 = arenas[1].initialize(size0);
+                }
+
+                if (0 != size0 && 0 != size1)
+                {
+                    current_index = 0;
+                    return size0;
+                }
+
+                // only one arena fit; give its memory back and split what's left between the two
+                arenas[0].initialize(nullptr, 0);
+                arenas[1].initialize(nullptr, 0);
+                size = size0 / 2;
+            }
+
+            return 0;
+        }
+
+        // call once at the start of a frame: last frame's arena becomes previous(), and the arena from the
+        // frame before that is reset to become current()
+        void swap()
+        {
+            current_index ^= 1;
+            arenas[current_index].reset();
+        }
+
+        // allocations for this frame and the next one
+        memory_arena& current()
+        {
+            return arenas[current_index];
+        }
+
+        // last frame's allocations; released by the next swap()
+        const memory_arena& previous() const
+        {
+            return arenas[current_index ^ 1];
+        }
+
+#if CLG_ARENA_INSTRUMENTATION
+        // append the statistics of both arenas to an open file
+        void write_stats(SDFile* file, const char* arena_name) const
+        {
+            char name[64];
+            for (int i = 0; i < 2; i++)
+            {
+                snprintf(name, sizeof(name), "%s[%d]", arena_name, i);
+                arenas[i].write_stats(file, name);
+            }
+        }
+#endif // CLG_ARENA_INSTRUMENTATION
+
+        private:
+        memory_arena arenas[2];
+        int current_index;
+    };
+
+    // Rolls an arena back to where it was when the scope was entered, so nested temporary allocations
+    // can be reused right away instead of waiting for the arena's next reset().
+    class arena_scope
+    {
+        public:
+        explicit arena_scope(memory_arena& scoped_arena)
+            : arena(scoped_arena)
+            , saved(scoped_arena.get_marker())
+        {
+        }
+
+        ~arena_scope()
+        {
+            arena.rewind(saved);
+        }
+
+        arena_scope(const arena_scope&) = delete;
+        arena_scope& operator=(const arena_scope&) = delete;
+
+        private:
+        memory_arena& arena;
+        const memory_arena::marker saved;
     };
 } // namespace clg
 
@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGPHYSICSBUDGET_HPP
+#define CLGPHYSICSBUDGET_HPP
+
+#include <cstdint>
+
+namespace clg
+{
+    // Keeps the physics inside its share of the frame.
+    //
+    // The time measured around each b2World::Step() is smoothed; while it's over step_budget the solver
+    // iterations are lowered (velocity first), and while it's comfortably under they're raised again
+    // (position first). can_run_tick() caps the fixed updates run in one frame, so a slow frame turns
+    // into a moment of slow motion instead of a growing backlog of catch-up steps.
+    class physics_budget
+    {
+        public:
+        struct settings
+        {
+            int min_velocity_iterations;
+            int max_velocity_iterations;
+            int min_position_iterations;
+            int max_position_iterations;
+            float step_budget;          // seconds per b2World::Step()
+            float frame_tick_budget;    // seconds of fixed updates per frame, measured from the frame's start
+            int max_ticks_per_frame;
+        };
+
+        struct statistics
+        {
+            float average_step_time;    // seconds, smoothed
+            uint32_t iteration_change_count;
+            uint32_t slow_frame_count;  // frames that dropped time
+            float dropped_time;         // seconds of game time skipped in total
+        };
+
+        static constexpr float smoothing = 0.1f;            // weight of the newest step time
+        static constexpr float raise_threshold = 0.6f;      // raise iterations under this fraction of the budget
+        static constexpr int steps_between_changes = 10;    // let the average settle after a change
+
+        physics_budget()
+            : config()
+            , velocity_iterations(0)
+            , position_iterations(0)
+            , steps_until_change(0)
+            , is_adaptive(true)
+            , stats()
+        {
+        }
+
+        void initialize(const settings& budget_settings)
+        {
+            config = budget_settings;
+            velocity_iterations = config.max_velocity_iterations;
+            position_iterations = config.max_position_iterations;
+            steps_until_change = steps_between_changes;
+            stats = statistics();
+        }
+
+        // when off, the iterations stay at their maximums (e.g. so input recordings replay exactly)
+        void set_adaptive(bool adaptive)
+        {
+            is_adaptive = adaptive;
+            if (!is_adaptive)
+            {
+                velocity_iterations = config.max_velocity_iterations;
+                position_iterations = config.max_position_iterations;
+            }
+        }
+
+        // call after every b2World::Step() with the seconds it took
+        void record_step(float step_time)
+        {
+            stats.average_step_time += (step_time - stats.average_step_time) * smoothing;
+            if (!is_adaptive || --steps_until_change > 0)
+            {
+                return;
+            }
+
+            steps_until_change = steps_between_changes;
+            if (stats.average_step_time > config.step_budget)
+            {
+                if (velocity_iterations > config.min_velocity_iterations)
+                {
+                    velocity_iterations--;
+                    stats.iteration_change_count++;
+                }
+                else if (position_iterations > config.min_position_iterations)
+                {
+                    position_iterations--;
+                    stats.iteration_change_count++;
+                }
+            }
+            else if (stats.average_step_time < config.step_budget * raise_threshold)
+            {
+                if (position_iterations < config.max_position_iterations)
+                {
+                    position_iterations++;
+                    stats.iteration_change_count++;
+                }
+                else if (velocity_iterations < config.max_velocity_iterations)
+                {
+                    velocity_iterations++;
+                    stats.iteration_change_count++;
+                }
+            }
+        }
+
+        // whether another fixed update fits in this frame; the first one always runs
+        bool can_run_tick(int ticks_this_frame, float frame_elapsed_time) const
+        {
+            return 0 == ticks_this_frame ||
+                (ticks_this_frame < config.max_ticks_per_frame &&
+                 frame_elapsed_time + stats.average_step_time <= config.frame_tick_budget);
+        }
+
+        // call with the game time a frame had to skip
+        void record_dropped_time(float seconds)
+        {
+            stats.slow_frame_count++;
+            stats.dropped_time += seconds;
+        }
+
+        int get_velocity_iterations() const { return velocity_iterations; }
+        int get_position_iterations() const { return position_iterations; }
+        const statistics& get_stats() const { return stats; }
+
+        private:
+        settings config;
+        int velocity_iterations;
+        int position_iterations;
+        int steps_until_change;
+        bool is_adaptive;
+        statistics stats;
+    };
+} // namespace clg
+
+#endif // CLGPHYSICSBUDGET_HPP
@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGPOOL_HPP
+#define CLGPOOL_HPP
+
+#include <new>
+#include <utility>
+#include "memory.hpp"
+
+namespace clg
+{
+    // Fixed-size block allocator with an intrusive free list. All blocks are carved out of a single slab
+    // taken from a memory_arena, so alloc() and free() are O(1) and never touch the heap.
+    template<size_t block_size, size_t alignment = alignof(void*)>
+    class block_pool
+    {
+        static_assert(0 == (alignment & (alignment - 1)), "alignment must be a power of two");
+
+        // free blocks store the free list link inside themselves
+        struct free_block
+        {
+            free_block* p_next;
+        };
+
+        public:
+        static constexpr size_t slot_alignment = alignment > alignof(free_block) ? alignment : alignof(free_block);
+        static constexpr size_t slot_size =
+            ((block_size > sizeof(free_block) ? block_size : sizeof(free_block)) + slot_alignment - 1) & ~(slot_alignment - 1);
+
+        block_pool()
+            : p_slab(nullptr)
+            , p_free(nullptr)
+            , capacity(0)
+            , used_count(0)
+#if CLG_ARENA_INSTRUMENTATION
+            , peak_used_count(0)
+            , failed_count(0)
+#endif
+        {
+        }
+
+        // take room for block_count blocks from the arena
+        bool initialize(memory_arena& arena, size_t block_count)
+        {
+            p_slab = static_cast<uint8_t*>(arena.aligned_alloc<static_cast<int>(slot_alignment)>(slot_size * block_count, CLG_ARENA_TAG("block pool")));
+            if (nullptr == p_slab)
+            {
+                capacity = 0;
+                return false;
+            }
+
+            capacity = block_count;
+            clear();
+            return true;
+        }
+
+        // return every block to the pool at once
+        void clear()
+        {
+            p_free = nullptr;
+            for (size_t i = capacity; i-- > 0;)
+            {
+                auto p_block = reinterpret_cast<free_block*>(p_slab + i * slot_size);
+                p_block->p_next = p_free;
+                p_free = p_block;
+            }
+
+            used_count = 0;
+        }
+
+        // returns nullptr when every block is in use
+        void* alloc()
+        {
+            if (nullptr == p_free)
+            {
+#if CLG_ARENA_INSTRUMENTATION
+                failed_count++;
+#endif
+                return nullptr;
+            }
+
+            auto p_block = p_free;
+            p_free = p_block->p_next;
+            used_count++;
+#if CLG_ARENA_INSTRUMENTATION
+            peak_used_count = used_count > peak_used_count ? used_count : peak_used_count;
+#endif
+            return p_block;
+        }
+
+        void free(void* ptr)
+        {
+            if (nullptr == ptr)
+            {
+                return;
+            }
+
+            assert(owns(ptr));
+            auto p_block = static_cast<free_block*>(ptr);
+            p_block->p_next = p_free;
+            p_free = p_block;
+            used_count--;
+        }
+
+        bool owns(const void* ptr) const
+        {
+            const auto p = static_cast<const uint8_t*>(ptr);
+            return p >= p_slab && p < p_slab + capacity * slot_size && 0 == (p - p_slab) % slot_size;
+        }
+
+        size_t get_capacity() const { return capacity; }
+        size_t get_used_count() const { return used_count; }
+        size_t get_free_count() const { return capacity - used_count; }
+
+#if CLG_ARENA_INSTRUMENTATION
+        size_t get_peak_used_count() const { return peak_used_count; }
+        size_t get_failed_count() const { return failed_count; }
+#endif
+
+        private:
+        uint8_t* p_slab;
+        free_block* p_free;
+        size_t capacity;
+        size_t used_count;
+#if CLG_ARENA_INSTRUMENTATION
+        size_t peak_used_count;
+        size_t failed_count;
+#endif
+    };
+
+    // Typed pool of objects; constructs and destroys in place.
+    template<typename T>
+    class pool : public block_pool<sizeof(T), alignof(T)>
+    {
+        using base = block_pool<sizeof(T), alignof(T)>;
+
+        public:
+        // returns nullptr when the pool is full
+        template<typename... Params>
+        T* create(Params&&... args)
+        {
+            const auto p_block = base::alloc();
+            if (nullptr == p_block)
+            {
+                return nullptr;
+            }
+
+            return new (p_block) T(std::forward<Params>(args)...);
+        }
+
+        void destroy(T* p_object)
+        {
+            if (nullptr == p_object)
+            {
+                return;
+            }
+
+            p_object->~T();
+            base::free(p_object);
+        }
+    };
+} // namespace clg
+
+#endif // CLGPOOL_HPP
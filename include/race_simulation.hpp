@@ -0,0 +1,322 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGRACESIMULATION_HPP
+#define CLGRACESIMULATION_HPP
+
+#include <cmath>
+#include <new>
+#include "pd.hpp"
+#include "box2d/box2d.h"
+#include "sin_table.hpp"
+#include "memory.hpp"
+#include "size_class_allocator.hpp"
+#include "arena_allocator.hpp"
+#include "containers.hpp"
+#include "pool.hpp"
+#include "slot_map.hpp"
+#include "car_physics.hpp"
+#include "vehicle_system.hpp"
+#include "surface_map.hpp"
+#include "decal_layer.hpp"
+#include "physics_budget.hpp"
+#include "input_recorder.hpp"
+
+namespace clg
+{
+    // The game's fixed update: the player's car and the AI cars on the test track, the Box2D world, the
+    // skid marks they leave and the rewind buffer.
+    //
+    // src/main.cpp runs it from the Playdate's update callback; src/heap_check.cpp runs the same ticks on
+    // the host, so a heap allocation added anywhere in here fails that check.
+    // NOTE: Everything is allocated from the level arena by initialize(); nothing is ever released.
+    class race_simulation
+    {
+        public:
+        static constexpr size_t level_heap_size = 8u * 1024u * 1024u; // the simulation and the level's textures
+        static constexpr size_t physics_region_size = 1024u * 1024u; // everything Box2D allocates
+
+        static constexpr int ai_car_count = 12;
+        static constexpr int max_car_count = 1 + ai_car_count; // the player's car is first
+
+        // cars further than this from the player (the screen is 25m x 15m) switch to the kinematic model
+        static constexpr float lod_promote_distance = 24.0f; // meters
+        static constexpr float lod_demote_distance = 32.0f;
+
+        // the frame rate target is 50fps (20ms) with room left for drawing
+        static constexpr physics_budget::settings budget_settings =
+        {
+            4, 8,       // velocity iterations
+            2, 3,       // position iterations
+            0.004f,     // seconds per step
+            0.012f,     // seconds into the frame the last fixed update may start by
+            3,          // fixed updates per frame
+        };
+
+        static constexpr float pixels_per_meter = 16.0f; // of the skid marks and the screen
+        static constexpr int world_size_in_pixels = 4096; // 256m x 256m centered on the world origin
+
+        static constexpr float surface_cell_size = 2.0f; // meters
+        static constexpr int surface_grid_size = static_cast<int>(world_size_in_pixels / pixels_per_meter / surface_cell_size); // cells per side
+        static constexpr surface_id off_track_surface = surface_id::grass; // around the track and beyond the edges of the map
+
+        static constexpr int rewind_frame_count = 200; // 4 seconds of fixed updates
+
+        // a car on the track; game code keeps the slot_handle of the record rather than the vehicle index
+        struct car_record
+        {
+            Car* p_car;
+            int vehicle_index;  // into vehicle_system and its saved states
+            bool is_ai;
+            float weave_phase;  // radians; offsets the AI's weaving
+        };
+
+        // the state after a fixed update, kept for rewinding
+        struct rewind_frame
+        {
+            uint32_t fixed_update_count;
+            vehicle_system::car_state cars[max_car_count];
+        };
+
+        explicit race_simulation(memory_arena& level_arena)
+            : p_arena(&level_arena)
+            , p_world(nullptr)
+            , player(null_slot_handle)
+            , rewind_frames(arena_allocator<rewind_frame>(level_arena, CLG_ARENA_TAG("rewind")))
+            , fixed_update_count(0)
+        {
+        }
+
+        race_simulation(const race_simulation&) = delete;
+        race_simulation& operator=(const race_simulation&) = delete;
+
+        // build the world with the cars on their starting grid; Box2D allocates from the level arena after this
+        bool initialize()
+        {
+            if (!physics_allocator.initialize(*p_arena, physics_region_size))
+            {
+                pd::error("ERROR: failed to create the physics allocator");
+                return false;
+            }
+
+            b2_allocator = &physics_allocator;
+
+            // NOTE: The world and its allocations are released with the level heap; its destructor is never run.
+            auto p_world_memory = p_arena->aligned_alloc<alignof(b2World)>(sizeof(b2World), CLG_ARENA_TAG("physics world"));
+            p_world = nullptr != p_world_memory ? new (p_world_memory) b2World(b2Vec2(0.0f, 0.0f)) : nullptr;
+            if (nullptr == p_world)
+            {
+                pd::error("ERROR: failed to allocated memory for world physics");
+                return false;
+            }
+
+            if (!cars.initialize(*p_arena, max_car_count) || !car_records.initialize(*p_arena, max_car_count) ||
+                !vehicles.initialize(*p_arena, max_car_count))
+            {
+                pd::error("ERROR: failed to allocate memory for vehicle physics simulation");
+                return false;
+            }
+
+            player = create_car(b2Vec2(0.0f, 0.0f), false);
+            if (player.is_null())
+            {
+                return false;
+            }
+
+            // AI cars on a starting grid ahead of the player
+            for (int i = 0; i < ai_car_count; i++)
+            {
+                const b2Vec2 grid_position(-9.0f + 6.0f * (i % 4), 12.0f + 10.0f * (i / 4));
+                if (create_car(grid_position, true).is_null())
+                {
+                    return false;
+                }
+            }
+
+            if (!skid_marks.initialize(p_arena, -world_size_in_pixels / 2, -world_size_in_pixels / 2, world_size_in_pixels, world_size_in_pixels))
+            {
+                pd::error("ERROR: failed to create the skid mark layer");
+                return false;
+            }
+
+            if (!rewind_frames.initialize(rewind_frame_count))
+            {
+                pd::error("ERROR: failed to allocate memory for the rewind buffer");
+                return false;
+            }
+
+            budget.initialize(budget_settings);
+            fixed_update_count = 0;
+            return true;
+        }
+
+        static constexpr size_t get_surface_byte_count()
+        {
+            return surface_map::get_byte_count(surface_grid_size, surface_grid_size);
+        }
+
+        // use the track's surface cells (get_surface_byte_count() of them); paint_surfaces() fills them in
+        void set_surface_cells(surface_id* p_cells)
+        {
+            constexpr float surface_map_left = -world_size_in_pixels / 2 / pixels_per_meter;
+            surfaces.initialize(p_cells, surface_map_left, surface_map_left, surface_cell_size, surface_grid_size, surface_grid_size, off_track_surface);
+            vehicles.set_surfaces(&surfaces);
+        }
+
+        // test track surfaces: asphalt with a concrete start area, sand traps and grass beyond the edges
+        void paint_surfaces()
+        {
+            surfaces.fill(off_track_surface);
+            surfaces.fill_rect(-96.0f, -96.0f, 96.0f, 96.0f, surface_id::asphalt);
+            surfaces.fill_rect(-16.0f, -8.0f, 16.0f, 40.0f, surface_id::concrete);
+            surfaces.fill_rect(-24.0f, 56.0f, -8.0f, 72.0f, surface_id::sand);
+            surfaces.fill_rect(8.0f, 88.0f, 24.0f, 104.0f, surface_id::sand);
+            surfaces.fill_rect(-64.0f, -40.0f, -40.0f, -24.0f, surface_id::sand);
+        }
+
+        void set_player_control(Tire::ControlState control_state)
+        {
+            vehicles.set_control(car_records.get(player)->vehicle_index, control_state);
+        }
+
+        // one tick of the game: AI, vehicles, physics, skid marks and the rewind buffer
+        // NOTE: delta_time is in seconds
+        void fixed_update(float delta_time)
+        {
+            // AI cars drive flat out and weave
+            const auto fixed_game_time = fixed_update_count++ * delta_time;
+            for (const auto& record : car_records)
+            {
+                if (!record.is_ai)
+                {
+                    continue;
+                }
+
+                const auto weave = sin_lookup(fixed_game_time * 0.5f + record.weave_phase);
+                int ai_control = static_cast<int>(Tire::ControlState::Up);
+                if (weave > 0.3f)
+                    ai_control |= static_cast<int>(Tire::ControlState::Left);
+                if (weave < -0.3f)
+                    ai_control |= static_cast<int>(Tire::ControlState::Right);
+                vehicles.set_control(record.vehicle_index, static_cast<Tire::ControlState>(ai_control));
+            }
+
+            vehicles.update_lod(get_player_car().m_body->GetPosition(), lod_promote_distance, lod_demote_distance);
+            vehicles.update(delta_time);
+            const auto step_start_time = pd::getElapsedTime();
+            p_world->Step(delta_time, budget.get_velocity_iterations(), budget.get_position_iterations());
+            budget.record_step(pd::getElapsedTime() - step_start_time);
+
+            stamp_skid_marks();
+            save_rewind_frame();
+        }
+
+        // hash of every car body's state; equal checksums mean the simulations haven't diverged
+        uint32_t get_checksum() const
+        {
+            uint32_t hash = hash_fnv1a(&fixed_update_count, sizeof(fixed_update_count));
+            for (int car_index = 0; car_index < vehicles.get_car_count(); car_index++)
+            {
+                const auto p_car = vehicles.get_car(car_index);
+                hash = hash_body(p_car->m_body, hash);
+                for (const auto& tire : p_car->m_tires)
+                {
+                    hash = hash_body(tire.m_body, hash);
+                }
+            }
+
+            return hash;
+        }
+
+        // the states left by the last rewind_frame_count fixed updates, oldest first
+        ring_buffer<rewind_frame>& get_rewind_frames() { return rewind_frames; }
+
+        void restore_rewind_frame(const rewind_frame& frame)
+        {
+            fixed_update_count = frame.fixed_update_count;
+            vehicles.restore_state(frame.cars);
+        }
+
+        b2World& get_world() { return *p_world; }
+        vehicle_system& get_vehicles() { return vehicles; }
+        const vehicle_system& get_vehicles() const { return vehicles; }
+        const slot_map<car_record>& get_cars() const { return car_records; }
+        slot_handle get_player() const { return player; }
+        const Car& get_player_car() const { return *car_records.get(player)->p_car; }
+        const decal_layer& get_skid_marks() const { return skid_marks; }
+        physics_budget& get_physics_budget() { return budget; }
+        const size_class_allocator& get_physics_allocator() const { return physics_allocator; }
+        uint32_t get_fixed_update_count() const { return fixed_update_count; }
+
+        private:
+        // create the bodies, joints and simulation of a car centered on position
+        slot_handle create_car(const b2Vec2& position, bool is_ai)
+        {
+            auto p_car = cars.create();
+            if (nullptr == p_car)
+            {
+                pd::error("ERROR: failed to allocate memory for a car");
+                return null_slot_handle;
+            }
+
+            p_car->Create(*p_world, position);
+            const auto vehicle_index = vehicles.add(p_car);
+            return car_records.insert(car_record{ p_car, vehicle_index, is_ai, static_cast<float>(vehicle_index) });
+        }
+
+        // stamp a mark under every tire that is currently skidding
+        void stamp_skid_marks()
+        {
+            for (int car_index = 0; car_index < vehicles.get_car_count(); car_index++)
+            {
+                for (const auto& tire : vehicles.get_car(car_index)->m_tires)
+                {
+                    if (tire.IsSkidding)
+                    {
+                        const auto& position = tire.m_body->GetPosition();
+                        skid_marks.stamp(
+                            static_cast<int>(std::round(position.x * pixels_per_meter)),
+                            static_cast<int>(std::round(position.y * pixels_per_meter)),
+                            1);
+                    }
+                }
+            }
+        }
+
+        // keep the state left by this fixed update; the oldest frame makes room once the buffer is full
+        void save_rewind_frame()
+        {
+            auto& frame = rewind_frames.emplace_back_overwrite();
+            frame.fixed_update_count = fixed_update_count;
+            vehicles.save_state(frame.cars);
+        }
+
+        static uint32_t hash_body(const b2Body* p_body, uint32_t hash)
+        {
+            const auto& transform = p_body->GetTransform();
+            const auto& velocity = p_body->GetLinearVelocity();
+            const float angular_velocity = p_body->GetAngularVelocity();
+            hash = hash_fnv1a(&transform, sizeof(transform), hash);
+            hash = hash_fnv1a(&velocity, sizeof(velocity), hash);
+            return hash_fnv1a(&angular_velocity, sizeof(angular_velocity), hash);
+        }
+
+        memory_arena* p_arena;
+        size_class_allocator physics_allocator;
+        b2World* p_world;
+        pool<Car> cars;
+        slot_map<car_record> car_records;
+        vehicle_system vehicles;
+        slot_handle player;
+        surface_map surfaces;
+        decal_layer skid_marks;
+        ring_buffer<rewind_frame> rewind_frames;
+        physics_budget budget;
+        uint32_t fixed_update_count;
+    };
+} // namespace clg
+
+#endif // CLGRACESIMULATION_HPP
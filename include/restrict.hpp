@@ -0,0 +1,18 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGRESTRICT_HPP
+#define CLGRESTRICT_HPP
+
+// Marks a pointer as the only way to reach its data within a loop, so the compiler can keep values in
+// registers and vectorize across stores.
+#if defined(__GNUC__) || defined(__clang__)
+  #define CLG_RESTRICT __restrict__
+#else
+  #define CLG_RESTRICT
+#endif
+
+#endif // CLGRESTRICT_HPP
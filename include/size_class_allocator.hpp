@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGSIZECLASSALLOCATOR_HPP
+#define CLGSIZECLASSALLOCATOR_HPP
+
+#include "memory.hpp"
+#include "tlsf.hpp"
+
+namespace clg
+{
+    // General purpose allocator for code that frees memory without passing the size back (e.g. Box2D).
+    //
+    // Requests are rounded up to power-of-two size classes, each with its own free list. The region taken
+    // from a memory_arena is split into pages; a page is dedicated to one size class the first time that
+    // class runs dry, and a table of page classes lets free() find a block's class without a header (so
+    // Box2D's 16KB block allocator chunks don't round up to 32KB). Requests larger than the biggest class,
+    // or made after the region is exhausted, go to heap_alloc(). reset() releases the whole region at once.
+    class size_class_allocator
+    {
+        struct free_block
+        {
+            free_block* p_next;
+        };
+
+        public:
+        static constexpr int min_class_shift = 4;   // 16 bytes
+        static constexpr int max_class_shift = 17;  // 128KB
+        static constexpr int page_shift = 14;       // 16KB; classes above this span several whole pages
+        static constexpr int class_count = max_class_shift - min_class_shift + 1;
+        static constexpr size_t page_size = static_cast<size_t>(1) << page_shift;
+
+        struct statistics
+        {
+            size_t region_size;
+            size_t used_page_count;
+            size_t bytes_in_use;                // rounded up to the size classes
+            size_t peak_bytes_in_use;
+            uint32_t live_count[class_count];   // live allocations per size class
+            uint32_t heap_live_count;           // live allocations that went to heap_alloc()
+            uint32_t heap_allocation_count;     // total allocations that went to heap_alloc()
+        };
+
+        size_class_allocator()
+            : p_region(nullptr)
+            , p_page_classes(nullptr)
+            , page_count(0)
+            , next_page(0)
+            , free_lists()
+            , stats()
+        {
+        }
+
+        // take a region of about byte_count bytes (whole pages) from the parent arena
+        bool initialize(memory_arena& parent, size_t byte_count)
+        {
+            const auto requested_page_count = byte_count >> page_shift;
+            p_page_classes = static_cast<uint8_t*>(parent.alloc(requested_page_count, CLG_ARENA_TAG("size class pages")));
+            p_region = static_cast<uint8_t*>(parent.aligned_alloc<16>(requested_page_count << page_shift, CLG_ARENA_TAG("size class region")));
+            if (nullptr == p_page_classes || nullptr == p_region)
+            {
+                p_region = nullptr;
+                page_count = 0;
+                return false;
+            }
+
+            page_count = requested_page_count;
+            reset();
+            return true;
+        }
+
+        // release every block in the region at once
+        // NOTE: Allocations that fell back to the heap must still be freed individually.
+        void reset()
+        {
+            next_page = 0;
+            std::fill(free_lists, free_lists + class_count, nullptr);
+
+            const auto heap_live_count = stats.heap_live_count;
+            const auto heap_allocation_count = stats.heap_allocation_count;
+            stats = statistics();
+            stats.region_size = page_count << page_shift;
+            stats.heap_live_count = heap_live_count;
+            stats.heap_allocation_count = heap_allocation_count;
+        }
+
+        void* alloc(size_t size)
+        {
+            const int size_class = get_size_class(size);
+            if (size_class < class_count)
+            {
+                auto p_block = free_lists[size_class];
+                if (nullptr == p_block)
+                {
+                    p_block = take_pages(size_class);
+                }
+
+                if (nullptr != p_block)
+                {
+                    free_lists[size_class] = p_block->p_next;
+                    stats.live_count[size_class]++;
+                    stats.bytes_in_use += get_class_size(size_class);
+                    stats.peak_bytes_in_use = std::max(stats.peak_bytes_in_use, stats.bytes_in_use);
+                    return p_block;
+                }
+            }
+
+            // too big, or the region is exhausted
+            const auto ptr = heap_alloc(size);
+            if (nullptr != ptr)
+            {
+                stats.heap_live_count++;
+                stats.heap_allocation_count++;
+            }
+
+            return ptr;
+        }
+
+        void free(void* ptr)
+        {
+            if (nullptr == ptr)
+            {
+                return;
+            }
+
+            if (!is_in_region(ptr))
+            {
+                heap_free(ptr);
+                stats.heap_live_count--;
+                return;
+            }
+
+            const int size_class = p_page_classes[(static_cast<uint8_t*>(ptr) - p_region) >> page_shift];
+            assert(size_class < class_count);
+            stats.live_count[size_class]--;
+            stats.bytes_in_use -= get_class_size(size_class);
+
+            auto p_block = static_cast<free_block*>(ptr);
+            p_block->p_next = free_lists[size_class];
+            free_lists[size_class] = p_block;
+        }
+
+        bool is_in_region(const void* ptr) const
+        {
+            const auto p = static_cast<const uint8_t*>(ptr);
+            return p >= p_region && p < p_region + (next_page << page_shift);
+        }
+
+        const statistics& get_stats() const
+        {
+            return stats;
+        }
+
+        static constexpr size_t get_class_size(int size_class)
+        {
+            return static_cast<size_t>(1) << (size_class + min_class_shift);
+        }
+
+        private:
+        // index of the smallest class holding byte_count bytes; >= class_count when there is none
+        static int get_size_class(size_t byte_count)
+        {
+            if (byte_count <= get_class_size(0))
+            {
+                return 0;
+            }
+
+            const int shift = 32 - __builtin_clz(static_cast<uint32_t>(byte_count - 1)); // ceil(log2(byte_count))
+            return shift - min_class_shift;
+        }
+
+        // dedicate unused pages to a size class; returns the new free list or nullptr when the region is full
+        free_block* take_pages(int size_class)
+        {
+            const auto class_size = get_class_size(size_class);
+            const auto pages_needed = class_size > page_size ? class_size >> page_shift : 1;
+            if (next_page + pages_needed > page_count)
+            {
+                return nullptr;
+            }
+
+            const auto p_pages = p_region + (next_page << page_shift);
+            std::fill(p_page_classes + next_page, p_page_classes + next_page + pages_needed, static_cast<uint8_t>(size_class));
+            next_page += pages_needed;
+            stats.used_page_count = next_page;
+
+            // thread the page's blocks onto the free list in address order
+            const auto block_count = (pages_needed << page_shift) / class_size;
+            free_block* p_head = nullptr;
+            for (size_t i = block_count; i-- > 0;)
+            {
+                auto p_block = reinterpret_cast<free_block*>(p_pages + i * class_size);
+                p_block->p_next = p_head;
+                p_head = p_block;
+            }
+
+            free_lists[size_class] = p_head;
+            return p_head;
+        }
+
+        uint8_t* p_region;
+        uint8_t* p_page_classes;    // size class of each page in the region
+        size_t page_count;
+        size_t next_page;
+        free_block* free_lists[class_count];
+        statistics stats;
+    };
+} // namespace clg
+
+#endif // CLGSIZECLASSALLOCATOR_HPP
@@ -0,0 +1,209 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGSLOTMAP_HPP
+#define CLGSLOTMAP_HPP
+
+#include <cstdint>
+#include <new>
+#include <utility>
+#include "memory.hpp"
+
+namespace clg
+{
+    // Reference to an element of a slot_map: a slot index and the generation of that slot when the
+    // element was inserted. Removing the element bumps the generation, so old handles stop resolving.
+    struct slot_handle
+    {
+        static constexpr int index_bits = 16;
+        static constexpr uint32_t index_mask = (1u << index_bits) - 1u;
+        static constexpr uint32_t max_generation = 0xffffu;
+
+        uint32_t value;
+
+        static constexpr slot_handle make(uint32_t index, uint32_t generation)
+        {
+            return { (generation << index_bits) | index };
+        }
+
+        constexpr uint32_t index() const { return value & index_mask; }
+        constexpr uint32_t generation() const { return value >> index_bits; }
+
+        // generations start at 1, so a zero handle never resolves
+        constexpr bool is_null() const { return 0 == value; }
+        constexpr bool operator==(const slot_handle&) const = default;
+    };
+
+    constexpr slot_handle null_slot_handle = { 0 };
+
+    // Elements packed densely in arena memory, addressed by generational handles.
+    //
+    // insert(), remove() and lookups are O(1). remove() moves the last element into the hole, so the
+    // elements stay contiguous for iteration (in no particular order) and pointers to them are only good
+    // until the next remove(); hold handles instead.
+    template<typename T>
+    class slot_map
+    {
+        struct slot
+        {
+            uint32_t dense_or_next_free;    // index into the dense arrays, or the next free slot
+            uint32_t generation;
+        };
+
+        public:
+        static constexpr uint32_t max_capacity = slot_handle::index_mask; // the last index marks the end of the free list
+
+        slot_map()
+            : p_elements(nullptr)
+            , p_dense_to_slot(nullptr)
+            , p_slots(nullptr)
+            , capacity_count(0)
+            , count(0)
+            , first_free(0)
+        {
+        }
+
+        slot_map(const slot_map&) = delete;
+        slot_map& operator=(const slot_map&) = delete;
+
+        ~slot_map()
+        {
+            clear();
+        }
+
+        // take room for capacity elements from the arena
+        bool initialize(memory_arena& arena, uint32_t capacity)
+        {
+            assert(capacity <= max_capacity);
+            p_elements = static_cast<T*>(arena.aligned_alloc<static_cast<int>(alignof(T))>(sizeof(T) * capacity, CLG_ARENA_TAG("slot map elements")));
+            p_dense_to_slot = static_cast<uint32_t*>(arena.aligned_alloc<alignof(uint32_t)>(sizeof(uint32_t) * capacity, CLG_ARENA_TAG("slot map")));
+            p_slots = static_cast<slot*>(arena.aligned_alloc<alignof(slot)>(sizeof(slot) * capacity, CLG_ARENA_TAG("slot map")));
+            if (nullptr == p_elements || nullptr == p_dense_to_slot || nullptr == p_slots)
+            {
+                p_elements = nullptr;
+                capacity_count = 0;
+                return false;
+            }
+
+            capacity_count = capacity;
+            for (uint32_t i = 0; i < capacity; i++)
+            {
+                p_slots[i] = { i + 1, 1 };
+            }
+
+            count = 0;
+            first_free = 0;
+            return true;
+        }
+
+        // returns the null handle when the map is full
+        template<typename... Params>
+        slot_handle insert(Params&&... args)
+        {
+            if (first_free >= capacity_count)
+            {
+                return null_slot_handle;
+            }
+
+            const auto index = first_free;
+            auto& s = p_slots[index];
+            first_free = s.dense_or_next_free;
+
+            new (p_elements + count) T(std::forward<Params>(args)...);
+            p_dense_to_slot[count] = index;
+            s.dense_or_next_free = count;
+            count++;
+            return slot_handle::make(index, s.generation);
+        }
+
+        // returns false if the handle is stale
+        bool remove(slot_handle handle)
+        {
+            if (!contains(handle))
+            {
+                return false;
+            }
+
+            auto& s = p_slots[handle.index()];
+            const auto dense = s.dense_or_next_free;
+            const auto last = count - 1;
+            if (dense != last)
+            {
+                p_elements[dense] = std::move(p_elements[last]);
+                p_dense_to_slot[dense] = p_dense_to_slot[last];
+                p_slots[p_dense_to_slot[dense]].dense_or_next_free = dense;
+            }
+
+            p_elements[last].~T();
+            count--;
+
+            // retire the slot; a slot whose generation is used up is never handed out again
+            s.generation++;
+            if (s.generation <= slot_handle::max_generation)
+            {
+                s.dense_or_next_free = first_free;
+                first_free = handle.index();
+            }
+
+            return true;
+        }
+
+        bool contains(slot_handle handle) const
+        {
+            const auto index = handle.index();
+            return index < capacity_count && p_slots[index].generation == handle.generation() && !handle.is_null();
+        }
+
+        // returns nullptr if the handle is stale
+        T* get(slot_handle handle)
+        {
+            return contains(handle) ? p_elements + p_slots[handle.index()].dense_or_next_free : nullptr;
+        }
+
+        const T* get(slot_handle handle) const
+        {
+            return const_cast<slot_map*>(this)->get(handle);
+        }
+
+        // handle of the element at a position in the dense array (e.g. while iterating)
+        slot_handle handle_at(uint32_t dense_index) const
+        {
+            assert(dense_index < count);
+            const auto index = p_dense_to_slot[dense_index];
+            return slot_handle::make(index, p_slots[index].generation);
+        }
+
+        // remove every element; outstanding handles become stale
+        void clear()
+        {
+            while (count > 0)
+            {
+                remove(handle_at(count - 1));
+            }
+        }
+
+        T* begin() { return p_elements; }
+        T* end() { return p_elements + count; }
+        const T* begin() const { return p_elements; }
+        const T* end() const { return p_elements + count; }
+        T& operator[](uint32_t dense_index) { assert(dense_index < count); return p_elements[dense_index]; }
+        const T& operator[](uint32_t dense_index) const { assert(dense_index < count); return p_elements[dense_index]; }
+
+        uint32_t size() const { return count; }
+        uint32_t capacity() const { return capacity_count; }
+        bool empty() const { return 0 == count; }
+
+        private:
+        T* p_elements;
+        uint32_t* p_dense_to_slot;
+        slot* p_slots;
+        uint32_t capacity_count;
+        uint32_t count;
+        uint32_t first_free;
+    };
+} // namespace clg
+
+#endif // CLGSLOTMAP_HPP
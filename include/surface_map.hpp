@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGSURFACEMAP_HPP
+#define CLGSURFACEMAP_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "car_physics.hpp"
+
+namespace clg
+{
+    enum class surface_id : uint8_t
+    {
+        asphalt = 0,
+        concrete,
+        grass,
+        sand,
+        count
+    };
+
+    // multiplied by the weight on a tire (see formula::TireFrictionForce() and formula::RollingResistance())
+    struct surface_coefficients
+    {
+        float static_friction;
+        float dynamic_friction;
+        float rolling_resistance;
+    };
+
+    constexpr surface_coefficients surface_table[static_cast<int>(surface_id::count)] =
+    {
+        { formula::staticFrictionCoefficient, formula::dynamicFrictionCoefficient, formula::rollingResistanceCoefficient }, // asphalt
+        { 3.2f, 1.8f, 0.0125f },    // concrete
+        { 2.0f, 1.2f, 0.08f },      // grass
+        { 1.5f, 1.0f, 0.3f },       // sand
+    };
+
+    // Coarse world-space grid of surface IDs, so a tire finds what it's driving on with one lookup
+    // instead of sensor fixtures and contact callbacks.
+    // NOTE: The cells are plain bytes in memory the map doesn't own (e.g. part of a level snapshot).
+    class surface_map
+    {
+        public:
+        surface_map()
+            : p_cells(nullptr)
+            , left(0.0f)
+            , bottom(0.0f)
+            , cells_per_meter(0.0f)
+            , column_count(0)
+            , row_count(0)
+            , outside(surface_id::asphalt)
+        {
+        }
+
+        static constexpr size_t get_byte_count(int columns, int rows)
+        {
+            return sizeof(surface_id) * columns * rows;
+        }
+
+        // covers columns x rows cells of cell_size meters with the bottom-left corner at (left_x, bottom_y);
+        // everything beyond them reads as outside_surface
+        void initialize(surface_id* p_cell_memory, float left_x, float bottom_y, float cell_size, int columns, int rows, surface_id outside_surface)
+        {
+            p_cells = p_cell_memory;
+            left = left_x;
+            bottom = bottom_y;
+            cells_per_meter = 1.0f / cell_size;
+            column_count = columns;
+            row_count = rows;
+            outside = outside_surface;
+        }
+
+        void fill(surface_id surface)
+        {
+            std::fill(p_cells, p_cells + column_count * row_count, surface);
+        }
+
+        // paint the cells overlapping a world-space rectangle (in meters)
+        void fill_rect(float x0, float y0, float x1, float y1, surface_id surface)
+        {
+            const auto first_column = std::max(get_column(x0), 0);
+            const auto last_column = std::min(get_column(x1), column_count - 1);
+            const auto first_row = std::max(get_row(y0), 0);
+            const auto last_row = std::min(get_row(y1), row_count - 1);
+            for (int row = first_row; row <= last_row; row++)
+            {
+                std::fill(p_cells + row * column_count + first_column, p_cells + row * column_count + last_column + 1, surface);
+            }
+        }
+
+        // the surface at a world position
+        surface_id get_surface(float x, float y) const
+        {
+            const auto column = get_column(x);
+            const auto row = get_row(y);
+            if (static_cast<unsigned>(column) >= static_cast<unsigned>(column_count) || static_cast<unsigned>(row) >= static_cast<unsigned>(row_count))
+            {
+                return outside;
+            }
+
+            return p_cells[row * column_count + column];
+        }
+
+        const surface_coefficients& sample(float x, float y) const
+        {
+            return surface_table[static_cast<int>(get_surface(x, y))];
+        }
+
+        private:
+        int get_column(float x) const { return static_cast<int>(std::floor((x - left) * cells_per_meter)); }
+        int get_row(float y) const { return static_cast<int>(std::floor((y - bottom) * cells_per_meter)); }
+
+        surface_id* p_cells;
+        float left;
+        float bottom;
+        float cells_per_meter;
+        int column_count;
+        int row_count;
+        surface_id outside;
+    };
+} // namespace clg
+
+#endif // CLGSURFACEMAP_HPP
@@ -0,0 +1,349 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGTLSF_HPP
+#define CLGTLSF_HPP
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace clg
+{
+    // Two-Level Segregated Fit allocator (Masmano et al.) managing one block of memory.
+    //
+    // Free blocks are binned by the power of two of their size (first level) and 16 linear steps within
+    // it (second level), with a bitmap per level; alloc() and free() are O(1) with no searching or heap
+    // calls. Neighboring free blocks are merged immediately.
+    class tlsf_heap
+    {
+        static constexpr size_t free_flag = 1;
+        static constexpr size_t flag_mask = alignof(std::max_align_t) - 1; // the low bits of aligned sizes are free for flags
+
+        // Every block starts with this header; free blocks keep their free list links in the payload.
+        // The sizes are whole block sizes (header included) so the next block is at this + size.
+        struct block
+        {
+            block* p_prev_physical;     // nullptr for the first block
+            size_t size_and_flags;
+            block* p_next_free;         // \ only valid while free
+            block* p_prev_free;         // /
+
+            size_t size() const { return size_and_flags & ~flag_mask; }
+            bool is_free() const { return 0 != (size_and_flags & free_flag); }
+            void set(size_t size, bool is_free_block) { size_and_flags = size | (is_free_block ? free_flag : 0); }
+            block* next_physical() { return reinterpret_cast<block*>(reinterpret_cast<uint8_t*>(this) + size()); }
+        };
+
+        public:
+        // NOTE: This backs the global operator new, so blocks are aligned for any fundamental type
+        //  (8 bytes on the device, 16 on 64-bit hosts).
+        static constexpr size_t alignment = alignof(std::max_align_t);
+        static constexpr int second_level_bits = 4;
+        static constexpr int second_level_count = 1 << second_level_bits;
+        static constexpr int first_level_shift = second_level_bits + std::bit_width(alignment) - 1;  // + log2(alignment)
+        static constexpr int first_level_max = 30;                          // blocks up to 1GB
+        static constexpr int first_level_count = first_level_max - first_level_shift + 1;
+        static constexpr size_t small_block_size = static_cast<size_t>(1) << first_level_shift;
+        static constexpr size_t header_size = (offsetof(block, p_next_free) + alignment - 1) & ~(alignment - 1);
+        static constexpr size_t min_block_size = (sizeof(block) + alignment - 1) & ~(alignment - 1);
+
+        struct statistics
+        {
+            size_t total_size;
+            size_t used_size;           // including block headers
+            size_t free_size;
+            size_t largest_free_size;
+            uint32_t used_block_count;
+            uint32_t free_block_count;
+
+            // 0 when all the free memory is one block; approaches 1 as it's split into small pieces
+            float fragmentation() const
+            {
+                return 0 == free_size ? 0.0f : 1.0f - static_cast<float>(largest_free_size) / free_size;
+            }
+        };
+
+        tlsf_heap()
+            : p_pool(nullptr)
+            , pool_size(0)
+            , first_level_bitmap(0)
+            , second_level_bitmaps()
+            , free_lists()
+            , used_size(0)
+            , used_block_count(0)
+            , free_block_count(0)
+        {
+        }
+
+        // manage size bytes at ptr; the memory isn't owned or released by the heap
+        bool initialize(void* ptr, size_t size)
+        {
+            const auto begin = (reinterpret_cast<uintptr_t>(ptr) + alignment - 1) & ~(alignment - 1);
+            const auto end = (reinterpret_cast<uintptr_t>(ptr) + size) & ~(alignment - 1);
+            if (nullptr == ptr || end <= begin || end - begin < min_block_size + header_size)
+            {
+                return false;
+            }
+
+            p_pool = reinterpret_cast<uint8_t*>(begin);
+            pool_size = end - begin;
+            first_level_bitmap = 0;
+            for (int i = 0; i < first_level_count; i++)
+            {
+                second_level_bitmaps[i] = 0;
+                for (int j = 0; j < second_level_count; j++)
+                {
+                    free_lists[i][j] = nullptr;
+                }
+            }
+
+            // one free block spanning the pool, then a zero size used sentinel that stops merging
+            auto p_block = reinterpret_cast<block*>(p_pool);
+            p_block->p_prev_physical = nullptr;
+            p_block->set(pool_size - header_size, true);
+            auto p_sentinel = p_block->next_physical();
+            p_sentinel->p_prev_physical = p_block;
+            p_sentinel->set(0, false);
+
+            used_size = header_size;
+            used_block_count = 0;
+            free_block_count = 0;
+            insert_free_block(p_block);
+            return true;
+        }
+
+        // returns nullptr when no free block is big enough
+        void* alloc(size_t size)
+        {
+            if (size > (static_cast<size_t>(1) << first_level_max) - header_size - alignment)
+            {
+                return nullptr;
+            }
+
+            size = (size + header_size + alignment - 1) & ~(alignment - 1);
+            size = size < min_block_size ? min_block_size : size;
+
+            auto p_block = find_free_block(size);
+            if (nullptr == p_block)
+            {
+                return nullptr;
+            }
+
+            remove_free_block(p_block);
+
+            // give the rest back if it's big enough to be a block of its own
+            const auto remainder_size = p_block->size() - size;
+            if (remainder_size >= min_block_size)
+            {
+                p_block->set(size, false);
+                auto p_remainder = p_block->next_physical();
+                p_remainder->p_prev_physical = p_block;
+                p_remainder->set(remainder_size, true);
+                p_remainder->next_physical()->p_prev_physical = p_remainder;
+                insert_free_block(p_remainder);
+            }
+            else
+            {
+                p_block->set(p_block->size(), false);
+            }
+
+            used_size += p_block->size();
+            used_block_count++;
+            return reinterpret_cast<uint8_t*>(p_block) + header_size;
+        }
+
+        void free(void* ptr)
+        {
+            if (nullptr == ptr)
+            {
+                return;
+            }
+
+            assert(owns(ptr));
+            auto p_block = reinterpret_cast<block*>(static_cast<uint8_t*>(ptr) - header_size);
+            assert(!p_block->is_free());
+            used_size -= p_block->size();
+            used_block_count--;
+
+            // merge with free neighbors
+            auto p_previous = p_block->p_prev_physical;
+            if (nullptr != p_previous && p_previous->is_free())
+            {
+                remove_free_block(p_previous);
+                p_previous->set(p_previous->size() + p_block->size(), true);
+                p_block = p_previous;
+            }
+
+            auto p_next = p_block->next_physical();
+            if (p_next->is_free())
+            {
+                remove_free_block(p_next);
+                p_block->set(p_block->size() + p_next->size(), true);
+            }
+
+            p_block->set(p_block->size(), true);
+            p_block->next_physical()->p_prev_physical = p_block;
+            insert_free_block(p_block);
+        }
+
+        bool owns(const void* ptr) const
+        {
+            const auto p = static_cast<const uint8_t*>(ptr);
+            return p >= p_pool && p < p_pool + pool_size;
+        }
+
+        // NOTE: Only the largest size class's list is walked to find the largest free block.
+        statistics get_stats() const
+        {
+            statistics stats;
+            stats.total_size = pool_size;
+            stats.used_size = used_size;
+            stats.free_size = pool_size - used_size;
+            stats.largest_free_size = 0;
+            stats.used_block_count = used_block_count;
+            stats.free_block_count = free_block_count;
+            if (0 != first_level_bitmap)
+            {
+                const int first_level = 31 - __builtin_clz(first_level_bitmap);
+                const int second_level = 31 - __builtin_clz(second_level_bitmaps[first_level]);
+                for (auto p_block = free_lists[first_level][second_level]; nullptr != p_block; p_block = p_block->p_next_free)
+                {
+                    stats.largest_free_size = p_block->size() > stats.largest_free_size ? p_block->size() : stats.largest_free_size;
+                }
+            }
+
+            return stats;
+        }
+
+        private:
+        // the bin a block of this size belongs to
+        static void map_insert(size_t size, int& first_level, int& second_level)
+        {
+            if (size < small_block_size)
+            {
+                first_level = 0;
+                second_level = static_cast<int>(size / (small_block_size / second_level_count));
+            }
+            else
+            {
+                const int top_bit = 31 - __builtin_clz(static_cast<uint32_t>(size));
+                second_level = static_cast<int>(size >> (top_bit - second_level_bits)) ^ second_level_count;
+                first_level = top_bit - first_level_shift + 1;
+            }
+        }
+
+        // the first bin where every block is at least this size
+        static void map_search(size_t size, int& first_level, int& second_level)
+        {
+            if (size >= small_block_size)
+            {
+                const int top_bit = 31 - __builtin_clz(static_cast<uint32_t>(size));
+                size += (static_cast<size_t>(1) << (top_bit - second_level_bits)) - 1;
+            }
+
+            map_insert(size, first_level, second_level);
+        }
+
+        block* find_free_block(size_t size) const
+        {
+            int first_level;
+            int second_level;
+            map_search(size, first_level, second_level);
+            if (first_level >= first_level_count)
+            {
+                return nullptr;
+            }
+
+            uint32_t second_level_map = second_level_bitmaps[first_level] & (~0u << second_level);
+            if (0 == second_level_map)
+            {
+                const uint32_t first_level_map = first_level + 1 < 32 ? first_level_bitmap & (~0u << (first_level + 1)) : 0;
+                if (0 == first_level_map)
+                {
+                    return nullptr;
+                }
+
+                first_level = __builtin_ctz(first_level_map);
+                second_level_map = second_level_bitmaps[first_level];
+            }
+
+            return free_lists[first_level][__builtin_ctz(second_level_map)];
+        }
+
+        void insert_free_block(block* p_block)
+        {
+            int first_level;
+            int second_level;
+            map_insert(p_block->size(), first_level, second_level);
+
+            auto& p_head = free_lists[first_level][second_level];
+            p_block->p_prev_free = nullptr;
+            p_block->p_next_free = p_head;
+            if (nullptr != p_head)
+            {
+                p_head->p_prev_free = p_block;
+            }
+
+            p_head = p_block;
+            first_level_bitmap |= 1u << first_level;
+            second_level_bitmaps[first_level] |= 1u << second_level;
+            free_block_count++;
+        }
+
+        void remove_free_block(block* p_block)
+        {
+            int first_level;
+            int second_level;
+            map_insert(p_block->size(), first_level, second_level);
+
+            if (nullptr != p_block->p_next_free)
+            {
+                p_block->p_next_free->p_prev_free = p_block->p_prev_free;
+            }
+
+            if (nullptr != p_block->p_prev_free)
+            {
+                p_block->p_prev_free->p_next_free = p_block->p_next_free;
+            }
+            else
+            {
+                auto& p_head = free_lists[first_level][second_level];
+                p_head = p_block->p_next_free;
+                if (nullptr == p_head)
+                {
+                    second_level_bitmaps[first_level] &= ~(1u << second_level);
+                    if (0 == second_level_bitmaps[first_level])
+                    {
+                        first_level_bitmap &= ~(1u << first_level);
+                    }
+                }
+            }
+
+            free_block_count--;
+        }
+
+        uint8_t* p_pool;
+        size_t pool_size;
+        uint32_t first_level_bitmap;
+        uint32_t second_level_bitmaps[first_level_count];
+        block* free_lists[first_level_count][second_level_count];
+        size_t used_size;
+        uint32_t used_block_count;
+        uint32_t free_block_count;
+    };
+
+    // When set, heap_alloc() and heap_free() use this instead of pd::realloc(); heap_alloc() falls back to
+    // pd::realloc() when it's full. Memory allocated before it was set is still freed correctly.
+    extern tlsf_heap* p_global_heap; // defined in pd.cpp
+
+    // general purpose heap used by global operator new/delete and Box2D's heap allocations
+    void* heap_alloc(size_t size);
+    void heap_free(void* ptr);
+} // namespace clg
+
+#endif // CLGTLSF_HPP
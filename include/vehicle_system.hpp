@@ -0,0 +1,654 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef CLGVEHICLESYSTEM_HPP
+#define CLGVEHICLESYSTEM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include "memory.hpp"
+#include "restrict.hpp"
+#include "car_physics.hpp"
+#include "surface_map.hpp"
+
+namespace clg
+{
+    // Runs the drag, tire friction and drive model of Car/Tire for many cars at once.
+    //
+    // Each update gathers the kinematics of every tire body into structure-of-arrays buffers, runs the
+    // formulas as straight loops over all tires, and scatters one combined force per body back to Box2D.
+    // The math matches Car::update(); the cars' Tire objects get their Speed and IsSkidding results.
+    // The friction and rolling resistance coefficients come from the surface_map under each tire, and
+    // are scaled by the load on the tire after Car::updateLoadTransfer().
+    //
+    // Cars far from the camera are demoted by update_lod() to a kinematic bicycle model: their bodies are
+    // disabled in Box2D and only moved to where the model puts them. Coming back into range promotes them
+    // to the full model again, with their speed, heading and steering carried over.
+    class vehicle_system
+    {
+        static constexpr int tires_per_car = 4;
+
+        // the bicycle model's state; the position is the rear axle's center
+        struct kinematic_state
+        {
+            b2Vec2 rear_axle;
+            float angle;
+            float speed;        // along the car's forward axis
+            float steering;     // front wheel angle relative to the chassis
+        };
+
+        // measured once when a car is added
+        struct car_geometry
+        {
+            b2Vec2 tire_offsets[tires_per_car];     // in the chassis' space
+            float rear_axle_y;                      // in the chassis' space
+            float wheelbase;
+            float mass;                             // chassis and tires
+            float full_drive_force;                 // all tires' force on the road at full throttle
+            float max_backward_speed;
+            float lower_steering_limit;
+            float upper_steering_limit;
+            float steering_rate;                    // radians per second
+            float steering_return_rate;
+            float friction_scale;
+        };
+
+        public:
+        struct body_state
+        {
+            b2Vec2 position;
+            float angle;
+            b2Vec2 linear_velocity;
+            float angular_velocity;
+        };
+
+        // Everything restore_state() needs to put a car back the way it was after a tick.
+        // NOTE: Box2D's contact and joint impulses aren't part of it, so a restored car can take a slightly
+        //  different path than it did the first time.
+        struct car_state
+        {
+            body_state bodies[1 + tires_per_car];   // chassis followed by the tires
+            float tire_speeds[tires_per_car];
+            Car::LoadTransferState load_transfer;
+            kinematic_state kinematic;              // only valid while the car is kinematic
+            float speed;
+            uint8_t skidding_tires;                 // a bit per tire
+            bool is_kinematic;
+        };
+
+        vehicle_system()
+            : p_cars(nullptr)
+            , p_controls(nullptr)
+            , p_is_kinematic(nullptr)
+            , p_kinematic(nullptr)
+            , p_geometry(nullptr)
+            , p_full_cars(nullptr)
+            , p_surfaces(nullptr)
+            , car_capacity(0)
+            , car_count(0)
+            , full_car_count(0)
+            , p_tire_bodies(nullptr)
+            , p_is_skidding(nullptr)
+            , p_forward_x(nullptr)
+            , p_forward_y(nullptr)
+            , p_velocity_x(nullptr)
+            , p_velocity_y(nullptr)
+            , p_speed(nullptr)
+            , p_force_x(nullptr)
+            , p_force_y(nullptr)
+            , p_max_drive_force(nullptr)
+            , p_max_backward_speed(nullptr)
+            , p_drive(nullptr)
+            , p_static_friction(nullptr)
+            , p_dynamic_friction(nullptr)
+            , p_rolling_resistance(nullptr)
+        {
+        }
+
+        // take room for max_car_count cars from the arena
+        bool initialize(memory_arena& arena, int max_car_count)
+        {
+            const auto tire_capacity = max_car_count * tires_per_car;
+            p_cars = static_cast<Car**>(arena.aligned_alloc<alignof(Car*)>(sizeof(Car*) * max_car_count, CLG_ARENA_TAG("vehicles")));
+            p_controls = static_cast<Tire::ControlState*>(arena.aligned_alloc<alignof(Tire::ControlState)>(sizeof(Tire::ControlState) * max_car_count, CLG_ARENA_TAG("vehicles")));
+            p_is_kinematic = static_cast<bool*>(arena.alloc(sizeof(bool) * max_car_count, CLG_ARENA_TAG("vehicles")));
+            p_kinematic = static_cast<kinematic_state*>(arena.aligned_alloc<alignof(kinematic_state)>(sizeof(kinematic_state) * max_car_count, CLG_ARENA_TAG("vehicles")));
+            p_geometry = static_cast<car_geometry*>(arena.aligned_alloc<alignof(car_geometry)>(sizeof(car_geometry) * max_car_count, CLG_ARENA_TAG("vehicles")));
+            p_full_cars = static_cast<int*>(arena.aligned_alloc<alignof(int)>(sizeof(int) * max_car_count, CLG_ARENA_TAG("vehicles")));
+            p_tire_bodies = static_cast<b2Body**>(arena.aligned_alloc<alignof(b2Body*)>(sizeof(b2Body*) * tire_capacity, CLG_ARENA_TAG("vehicles")));
+            p_is_skidding = static_cast<bool*>(arena.alloc(sizeof(bool) * tire_capacity, CLG_ARENA_TAG("vehicles")));
+            const auto alloc_floats = [&]() { return static_cast<float*>(arena.aligned_alloc<alignof(float)>(sizeof(float) * tire_capacity, CLG_ARENA_TAG("vehicles"))); };
+            p_forward_x = alloc_floats();
+            p_forward_y = alloc_floats();
+            p_velocity_x = alloc_floats();
+            p_velocity_y = alloc_floats();
+            p_speed = alloc_floats();
+            p_force_x = alloc_floats();
+            p_force_y = alloc_floats();
+            p_max_drive_force = alloc_floats();
+            p_max_backward_speed = alloc_floats();
+            p_drive = alloc_floats();
+            p_static_friction = alloc_floats();
+            p_dynamic_friction = alloc_floats();
+            p_rolling_resistance = alloc_floats();
+            if (nullptr == p_cars || nullptr == p_controls || nullptr == p_is_kinematic || nullptr == p_kinematic ||
+                nullptr == p_geometry || nullptr == p_full_cars || nullptr == p_tire_bodies || nullptr == p_is_skidding ||
+                nullptr == p_forward_x || nullptr == p_forward_y || nullptr == p_velocity_x || nullptr == p_velocity_y ||
+                nullptr == p_speed || nullptr == p_force_x || nullptr == p_force_y ||
+                nullptr == p_max_drive_force || nullptr == p_max_backward_speed || nullptr == p_drive ||
+                nullptr == p_static_friction || nullptr == p_dynamic_friction || nullptr == p_rolling_resistance)
+            {
+                return false;
+            }
+
+            car_capacity = max_car_count;
+            car_count = 0;
+            full_car_count = 0;
+            return true;
+        }
+
+        // returns the car's index, or -1 when full
+        int add(Car* p_car)
+        {
+            if (car_count == car_capacity)
+            {
+                return -1;
+            }
+
+            const auto car_index = car_count++;
+            p_cars[car_index] = p_car;
+            p_controls[car_index] = Tire::ControlState::Neutral;
+            p_is_kinematic[car_index] = false;
+            measure_geometry(car_index);
+            rebuild_tire_slots();
+            return car_index;
+        }
+
+        // without a map every tire is on asphalt
+        void set_surfaces(const surface_map* p_surface_map)
+        {
+            p_surfaces = p_surface_map;
+        }
+
+        void set_control(int car_index, Tire::ControlState control_state)
+        {
+            assert(car_index >= 0 && car_index < car_count);
+            p_controls[car_index] = control_state;
+        }
+
+        // Switch cars between the full and kinematic models by their distance from focus (e.g. the camera's
+        // center). The gap between the distances keeps cars near the edge from switching back and forth.
+        void update_lod(const b2Vec2& focus, float promote_distance, float demote_distance)
+        {
+            bool is_changed = false;
+            for (int car_index = 0; car_index < car_count; car_index++)
+            {
+                const auto distance_squared = (p_cars[car_index]->m_body->GetPosition() - focus).LengthSquared();
+                if (p_is_kinematic[car_index] && distance_squared < promote_distance * promote_distance)
+                {
+                    promote(car_index);
+                    is_changed = true;
+                }
+                else if (!p_is_kinematic[car_index] && distance_squared > demote_distance * demote_distance)
+                {
+                    demote(car_index);
+                    is_changed = true;
+                }
+            }
+
+            if (is_changed)
+            {
+                rebuild_tire_slots();
+            }
+        }
+
+        // NOTE: delta_time is in seconds
+        void update(float delta_time)
+        {
+            const int tire_count = full_car_count * tires_per_car;
+            gather(tire_count, delta_time);
+            apply_friction(tire_count, delta_time);
+            apply_drive(tire_count);
+            scatter(tire_count);
+            update_kinematic(delta_time);
+        }
+
+        // copy every car's state into p_states (get_car_count() of them)
+        void save_state(car_state* p_states) const
+        {
+            for (int car_index = 0; car_index < car_count; car_index++)
+            {
+                const auto p_car = p_cars[car_index];
+                auto& state = p_states[car_index];
+                save_body(p_car->m_body, state.bodies[0]);
+                state.skidding_tires = 0;
+                for (int i = 0; i < tires_per_car; i++)
+                {
+                    const auto& tire = p_car->m_tires[i];
+                    save_body(tire.m_body, state.bodies[i + 1]);
+                    state.tire_speeds[i] = tire.Speed;
+                    state.skidding_tires |= tire.IsSkidding ? 1 << i : 0;
+                }
+
+                state.load_transfer = p_car->getLoadTransferState();
+                state.kinematic = p_kinematic[car_index];
+                state.speed = p_car->Speed;
+                state.is_kinematic = p_is_kinematic[car_index];
+            }
+        }
+
+        // put every car back the way save_state() found it, including which model simulates it
+        void restore_state(const car_state* p_states)
+        {
+            for (int car_index = 0; car_index < car_count; car_index++)
+            {
+                auto p_car = p_cars[car_index];
+                const auto& state = p_states[car_index];
+                restore_body(p_car->m_body, state.bodies[0], state.is_kinematic);
+                for (int i = 0; i < tires_per_car; i++)
+                {
+                    auto& tire = p_car->m_tires[i];
+                    restore_body(tire.m_body, state.bodies[i + 1], state.is_kinematic);
+                    tire.Speed = state.tire_speeds[i];
+                    tire.IsSkidding = 0 != (state.skidding_tires & (1 << i));
+                }
+
+                p_car->setLoadTransferState(state.load_transfer);
+                p_car->Speed = state.speed;
+                p_kinematic[car_index] = state.kinematic;
+                p_is_kinematic[car_index] = state.is_kinematic;
+            }
+
+            rebuild_tire_slots();
+        }
+
+        int get_car_count() const { return car_count; }
+        int get_full_car_count() const { return full_car_count; }
+        Car* get_car(int car_index) const { return p_cars[car_index]; }
+        bool is_kinematic(int car_index) const { return p_is_kinematic[car_index]; }
+
+        private:
+        static constexpr float weight_per_tire = Car::totalWeight / tires_per_car;
+
+        void measure_geometry(int car_index)
+        {
+            const auto p_car = p_cars[car_index];
+            auto& geometry = p_geometry[car_index];
+            geometry.mass = p_car->m_body->GetMass();
+            geometry.full_drive_force = 0.0f;
+            for (int i = 0; i < tires_per_car; i++)
+            {
+                const auto& tire = p_car->m_tires[i];
+                geometry.tire_offsets[i] = p_car->m_body->GetLocalPoint(tire.m_body->GetPosition());
+                geometry.mass += tire.m_body->GetMass();
+                geometry.full_drive_force += formula::TireForceOnRoad(tire.getMaxDriveForce());
+            }
+
+            geometry.rear_axle_y = (geometry.tire_offsets[static_cast<int>(Car::TireIndex::BackLeft)].y + geometry.tire_offsets[static_cast<int>(Car::TireIndex::BackRight)].y) * 0.5f;
+            geometry.wheelbase = p_car->getWheelbase();
+            geometry.max_backward_speed = p_car->m_tires[0].getMaxBackwardSpeed();
+            geometry.lower_steering_limit = p_car->flJoint->GetLowerLimit();
+            geometry.upper_steering_limit = p_car->flJoint->GetUpperLimit();
+            geometry.steering_rate = p_car->getTuning().steeringRate * (b2_pi / 180.0f);
+            geometry.steering_return_rate = p_car->getTuning().steeringReturnRate;
+            geometry.friction_scale = p_car->getTuning().frictionScale;
+        }
+
+        static void save_body(const b2Body* p_body, body_state& state)
+        {
+            state.position = p_body->GetPosition();
+            state.angle = p_body->GetAngle();
+            state.linear_velocity = p_body->GetLinearVelocity();
+            state.angular_velocity = p_body->GetAngularVelocity();
+        }
+
+        static void restore_body(b2Body* p_body, const body_state& state, bool is_kinematic)
+        {
+            p_body->SetTransform(state.position, state.angle);
+            p_body->SetLinearVelocity(state.linear_velocity);
+            p_body->SetAngularVelocity(state.angular_velocity);
+            p_body->SetEnabled(!is_kinematic);
+            p_body->SetAwake(true);
+        }
+
+        // pack the tires of the fully simulated cars into the front of the per tire arrays
+        void rebuild_tire_slots()
+        {
+            full_car_count = 0;
+            for (int car_index = 0; car_index < car_count; car_index++)
+            {
+                if (p_is_kinematic[car_index])
+                {
+                    continue;
+                }
+
+                const auto slot = full_car_count++;
+                p_full_cars[slot] = car_index;
+                for (int i = 0; i < tires_per_car; i++)
+                {
+                    const auto& tire = p_cars[car_index]->m_tires[i];
+                    const auto tire_index = slot * tires_per_car + i;
+                    p_tire_bodies[tire_index] = tire.m_body;
+                    p_max_drive_force[tire_index] = formula::TireForceOnRoad(tire.getMaxDriveForce());
+                    p_max_backward_speed[tire_index] = tire.getMaxBackwardSpeed();
+                    p_is_skidding[tire_index] = tire.IsSkidding;
+                }
+            }
+        }
+
+        // take the bicycle model's state from Box2D, then take the car out of the world
+        void demote(int car_index)
+        {
+            auto p_car = p_cars[car_index];
+            const auto p_body = p_car->m_body;
+            auto& state = p_kinematic[car_index];
+            state.rear_axle = p_body->GetWorldPoint(b2Vec2(0.0f, p_geometry[car_index].rear_axle_y));
+            state.angle = p_body->GetAngle();
+            state.speed = b2Dot(p_body->GetLinearVelocity(), p_body->GetWorldVector(b2Vec2(0.0f, 1.0f)));
+            state.steering = p_car->flJoint->GetJointAngle();
+
+            p_body->SetEnabled(false);
+            for (auto& tire : p_car->m_tires)
+            {
+                tire.m_body->SetEnabled(false);
+                tire.IsSkidding = false;
+            }
+
+            p_is_kinematic[car_index] = true;
+        }
+
+        // put the car back in the world with velocities that match the bicycle model's motion
+        void promote(int car_index)
+        {
+            auto p_car = p_cars[car_index];
+            const auto& state = p_kinematic[car_index];
+            place_bodies(car_index);
+
+            const auto yaw_rate = get_yaw_rate(car_index, get_surface(state.rear_axle));
+            const auto rear_velocity = state.speed * b2Rot(state.angle).GetYAxis();
+            const auto set_velocity = [&](b2Body* p_body)
+            {
+                p_body->SetLinearVelocity(rear_velocity + b2Cross(yaw_rate, p_body->GetPosition() - state.rear_axle));
+                p_body->SetAngularVelocity(yaw_rate);
+                p_body->SetEnabled(true);
+            };
+
+            set_velocity(p_car->m_body);
+            for (auto& tire : p_car->m_tires)
+            {
+                set_velocity(tire.m_body);
+            }
+
+            p_car->resetLoadTransfer();
+
+            p_is_kinematic[car_index] = false;
+        }
+
+        // turning at the steering angle, but no tighter than the tires' sliding friction can hold
+        float get_yaw_rate(int car_index, const surface_coefficients& surface) const
+        {
+            const auto& state = p_kinematic[car_index];
+            const auto& geometry = p_geometry[car_index];
+            const auto yaw_rate = state.speed * std::tan(state.steering) / geometry.wheelbase;
+            const auto speed = state.speed < 0.0f ? -state.speed : state.speed;
+            const auto max_lateral_acceleration = tires_per_car * formula::TireDynamicFrictionForce(weight_per_tire, surface.dynamic_friction * geometry.friction_scale) / geometry.mass;
+            const auto max_yaw_rate = max_lateral_acceleration / (speed > 1.0f ? speed : 1.0f);
+            return std::clamp(yaw_rate, -max_yaw_rate, max_yaw_rate);
+        }
+
+        const surface_coefficients& get_surface(const b2Vec2& position) const
+        {
+            return nullptr == p_surfaces ? surface_table[static_cast<int>(surface_id::asphalt)] : p_surfaces->sample(position.x, position.y);
+        }
+
+        // move the (disabled) bodies to where the bicycle model has the car
+        void place_bodies(int car_index)
+        {
+            auto p_car = p_cars[car_index];
+            const auto& state = p_kinematic[car_index];
+            const auto& geometry = p_geometry[car_index];
+            const b2Rot rotation(state.angle);
+            const auto chassis_position = state.rear_axle - b2Mul(rotation, b2Vec2(0.0f, geometry.rear_axle_y));
+            p_car->m_body->SetTransform(chassis_position, state.angle);
+            for (int i = 0; i < tires_per_car; i++)
+            {
+                const bool is_front = i < 2;
+                p_car->m_tires[i].m_body->SetTransform(
+                    chassis_position + b2Mul(rotation, geometry.tire_offsets[i]),
+                    is_front ? state.angle + state.steering : state.angle);
+            }
+        }
+
+        // the bicycle model: no lateral slip, the drive and drag forces of Car::update() along the heading
+        void update_kinematic(float delta_time)
+        {
+            if (full_car_count == car_count)
+            {
+                return;
+            }
+
+            for (int car_index = 0; car_index < car_count; car_index++)
+            {
+                if (!p_is_kinematic[car_index])
+                {
+                    continue;
+                }
+
+                auto& state = p_kinematic[car_index];
+                const auto& geometry = p_geometry[car_index];
+                const auto control = static_cast<int>(p_controls[car_index]);
+
+                // steering follows Car::updateSteering() up to the joint limits
+                const auto steering = control & (static_cast<int>(Tire::ControlState::Left) | static_cast<int>(Tire::ControlState::Right));
+                if (static_cast<int>(Tire::ControlState::Left) == steering)
+                {
+                    state.steering -= geometry.steering_rate * delta_time;
+                }
+                else if (static_cast<int>(Tire::ControlState::Right) == steering)
+                {
+                    state.steering += geometry.steering_rate * delta_time;
+                }
+                else if (state.steering < -0.1f || state.steering > 0.1f)
+                {
+                    // decays toward center without overshooting it
+                    state.steering -= state.steering * std::min(geometry.steering_return_rate * delta_time, 1.0f);
+                }
+                state.steering = std::clamp(state.steering, geometry.lower_steering_limit, geometry.upper_steering_limit);
+
+                // as in Tire::updateDrive(), rolling resistance only applies while driving
+                const auto& surface = get_surface(state.rear_axle);
+                float force = 0.0f;
+                const auto rolling_resistance = tires_per_car * formula::RollingResistance(weight_per_tire, surface.rolling_resistance);
+                const auto drive = control & (static_cast<int>(Tire::ControlState::Up) | static_cast<int>(Tire::ControlState::Down));
+                if (static_cast<int>(Tire::ControlState::Up) == drive)
+                {
+                    force = geometry.full_drive_force - rolling_resistance;
+                }
+                else if (static_cast<int>(Tire::ControlState::Down) == drive && state.speed > geometry.max_backward_speed)
+                {
+                    force = -geometry.full_drive_force - rolling_resistance;
+                }
+                force -= state.speed < 0.0f ? -formula::AerodynamicDrag(-state.speed) : formula::AerodynamicDrag(state.speed);
+
+                // integrate the speed first (semi-implicit Euler, like Box2D)
+                state.speed += force / geometry.mass * delta_time;
+                state.angle += get_yaw_rate(car_index, surface) * delta_time;
+                state.rear_axle += (state.speed * delta_time) * b2Rot(state.angle).GetYAxis();
+
+                place_bodies(car_index);
+            }
+        }
+
+        // copy each tire's facing and velocity out of Box2D, look up the surface it's on, and work out
+        // how much of the car's weight it carries
+        void gather(int tire_count, float delta_time)
+        {
+            for (int i = 0; i < tire_count; i++)
+            {
+                const auto p_body = p_tire_bodies[i];
+                const auto& transform = p_body->GetTransform();
+                const auto& velocity = p_body->GetLinearVelocity();
+                p_forward_x[i] = -transform.q.s; // GetWorldVector(0, 1); the right vector is (forward_y, -forward_x)
+                p_forward_y[i] = transform.q.c;
+                p_velocity_x[i] = velocity.x;
+                p_velocity_y[i] = velocity.y;
+
+                // just the coefficients for now; they're scaled by the tire's load below
+                const auto& surface = get_surface(transform.p);
+                p_static_friction[i] = surface.static_friction;
+                p_dynamic_friction[i] = surface.dynamic_friction;
+                p_rolling_resistance[i] = surface.rolling_resistance;
+            }
+
+            for (int slot = 0; slot < full_car_count; slot++)
+            {
+                auto p_car = p_cars[p_full_cars[slot]];
+                p_car->updateLoadTransfer(delta_time);
+                const auto friction_scale = p_car->getTuning().frictionScale;
+                for (int i = 0; i < tires_per_car; i++)
+                {
+                    const auto tire_index = slot * tires_per_car + i;
+                    const auto load = p_car->TireLoads[i];
+                    p_static_friction[tire_index] = formula::TireStaticFrictionForce(load, p_static_friction[tire_index] * friction_scale);
+                    p_dynamic_friction[tire_index] = formula::TireDynamicFrictionForce(load, p_dynamic_friction[tire_index] * friction_scale);
+                    p_rolling_resistance[tire_index] = formula::RollingResistance(load, p_rolling_resistance[tire_index]);
+                }
+
+                const auto control = static_cast<int>(p_controls[p_full_cars[slot]]) &
+                    (static_cast<int>(Tire::ControlState::Up) | static_cast<int>(Tire::ControlState::Down));
+                const float drive = static_cast<int>(Tire::ControlState::Up) == control ? 1.0f :
+                    (static_cast<int>(Tire::ControlState::Down) == control ? -1.0f : 0.0f);
+                for (int i = 0; i < tires_per_car; i++)
+                {
+                    p_drive[slot * tires_per_car + i] = drive;
+                }
+            }
+        }
+
+        // Tire::updateFriction() for every tire
+        void apply_friction(int tire_count, float delta_time)
+        {
+            const float kg_per_second = (weight_per_tire / formula::gravitationalAcceleration) / delta_time;
+
+            const float* CLG_RESTRICT forward_x = p_forward_x;
+            const float* CLG_RESTRICT forward_y = p_forward_y;
+            const float* CLG_RESTRICT velocity_x = p_velocity_x;
+            const float* CLG_RESTRICT velocity_y = p_velocity_y;
+            const float* CLG_RESTRICT static_friction = p_static_friction;
+            const float* CLG_RESTRICT dynamic_friction = p_dynamic_friction;
+            float* CLG_RESTRICT force_x = p_force_x;
+            float* CLG_RESTRICT force_y = p_force_y;
+            for (int i = 0; i < tire_count; i++)
+            {
+                // the right vector is a unit vector, so the lateral force's magnitude is |lateral speed| * kg/s
+                const float right_x = forward_y[i];
+                const float right_y = -forward_x[i];
+                const float lateral_speed = right_x * velocity_x[i] + right_y * velocity_y[i];
+                const float lateral_force = (lateral_speed < 0.0f ? -lateral_speed : lateral_speed) * kg_per_second;
+                const float direction = lateral_speed > b2_epsilon ? 1.0f : (lateral_speed < -b2_epsilon ? -1.0f : 0.0f);
+
+                // friction counter acts the lateral force until the tire breaks loose, then it skids
+                const bool is_skidding = lateral_force >= static_friction[i];
+                const float magnitude = is_skidding ? dynamic_friction[i] : lateral_force;
+                force_x[i] = -direction * magnitude * right_x;
+                force_y[i] = -direction * magnitude * right_y;
+
+                p_is_skidding[i] = is_skidding ? (p_is_skidding[i] || lateral_force > dynamic_friction[i] * Tire::skidMarkThreshold) : false;
+            }
+        }
+
+        // Tire::updateDrive() for every tire
+        void apply_drive(int tire_count)
+        {
+            const float* CLG_RESTRICT forward_x = p_forward_x;
+            const float* CLG_RESTRICT forward_y = p_forward_y;
+            const float* CLG_RESTRICT velocity_x = p_velocity_x;
+            const float* CLG_RESTRICT velocity_y = p_velocity_y;
+            const float* CLG_RESTRICT drive = p_drive;
+            const float* CLG_RESTRICT max_drive_force = p_max_drive_force;
+            const float* CLG_RESTRICT max_backward_speed = p_max_backward_speed;
+            const float* CLG_RESTRICT rolling_resistance = p_rolling_resistance;
+            float* CLG_RESTRICT speed = p_speed;
+            float* CLG_RESTRICT force_x = p_force_x;
+            float* CLG_RESTRICT force_y = p_force_y;
+            for (int i = 0; i < tire_count; i++)
+            {
+                const float current_speed = forward_x[i] * velocity_x[i] + forward_y[i] * velocity_y[i];
+                speed[i] = current_speed;
+
+                // reverse is limited to the top backward speed; no throttle means no drive or rolling force
+                const bool is_driving = drive[i] > 0.0f || (drive[i] < 0.0f && current_speed > max_backward_speed[i]);
+                const float magnitude = is_driving ? drive[i] * max_drive_force[i] - rolling_resistance[i] : 0.0f;
+                force_x[i] += forward_x[i] * magnitude;
+                force_y[i] += forward_y[i] * magnitude;
+            }
+        }
+
+        // hand the forces to Box2D, and the results to the cars
+        void scatter(int tire_count)
+        {
+            for (int i = 0; i < tire_count; i++)
+            {
+                p_tire_bodies[i]->ApplyForceToCenter(b2Vec2(p_force_x[i], p_force_y[i]), true);
+            }
+
+            for (int slot = 0; slot < full_car_count; slot++)
+            {
+                const auto car_index = p_full_cars[slot];
+                auto p_car = p_cars[car_index];
+
+                // aerodynamic drag on the chassis
+                auto velocity_normal = p_car->m_body->GetLinearVelocity();
+                const auto current_speed = clg::Normalize(velocity_normal);
+                velocity_normal *= -formula::AerodynamicDrag(current_speed);
+                p_car->m_body->ApplyForceToCenter(velocity_normal, true);
+
+                float total_speed = 0.0f;
+                for (int i = 0; i < tires_per_car; i++)
+                {
+                    const auto tire_index = slot * tires_per_car + i;
+                    auto& tire = p_car->m_tires[i];
+                    tire.Speed = p_speed[tire_index];
+                    tire.IsSkidding = p_is_skidding[tire_index];
+                    total_speed += tire.Speed;
+                }
+
+                p_car->Speed = total_speed / tires_per_car;
+                p_car->updateSteering(p_controls[car_index]);
+            }
+        }
+
+        Car** p_cars;
+        Tire::ControlState* p_controls;
+        bool* p_is_kinematic;
+        kinematic_state* p_kinematic;   // only valid while the car is kinematic
+        car_geometry* p_geometry;
+        int* p_full_cars;               // indices of the cars Box2D simulates, in tire slot order
+        const surface_map* p_surfaces;
+        int car_capacity;
+        int car_count;
+        int full_car_count;
+
+        // per tire slot (the tires of the fully simulated cars)
+        b2Body** p_tire_bodies;
+        bool* p_is_skidding;
+        float* p_forward_x;
+        float* p_forward_y;
+        float* p_velocity_x;
+        float* p_velocity_y;
+        float* p_speed;
+        float* p_force_x;
+        float* p_force_y;
+        float* p_max_drive_force;     // force on the road at full throttle
+        float* p_max_backward_speed;
+        float* p_drive;               // throttle: 1 forward, -1 reverse, 0 none
+        float* p_static_friction;     // forces for the surface under the tire
+        float* p_dynamic_friction;
+        float* p_rolling_resistance;
+    };
+} // namespace clg
+
+#endif // CLGVEHICLESYSTEM_HPP
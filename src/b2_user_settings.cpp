@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include "pd.hpp"
+#include "clg-math/clg_math.hpp"
+#include "box2d/box2d.h"
+#include "size_class_allocator.hpp"
+#include "heap_tracker.hpp"
+#include "tlsf.hpp"
+
+clg::size_class_allocator* b2_allocator = nullptr;
+
+void* b2Alloc(int32 size)
+{
+    if (nullptr != b2_allocator)
+    {
+        const auto ptr = b2_allocator->alloc(size);
+#if CLG_HEAP_TRACKING
+        if (!b2_allocator->is_in_region(ptr))
+        {
+            clg::global_heap_tracker.record_allocation(size, "b2Alloc (size class region full)");
+        }
+#endif
+        return ptr;
+    }
+
+#if CLG_HEAP_TRACKING
+    clg::global_heap_tracker.record_allocation(size, "b2Alloc");
+#endif
+    return clg::heap_alloc(size);
+}
+
+void b2Free(void* mem)
+{
+#if CLG_HEAP_TRACKING
+    if (nullptr != mem && (nullptr == b2_allocator || !b2_allocator->is_in_region(mem)))
+    {
+        clg::global_heap_tracker.record_free();
+    }
+#endif
+
+    if (nullptr != b2_allocator)
+    {
+        // NOTE: also frees the heap fallback allocations
+        b2_allocator->free(mem);
+        return;
+    }
+
+    clg::heap_free(mem);
+}
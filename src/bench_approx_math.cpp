@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Host-side error report and timing for approx_math.hpp versus libm.
+//
+// build command:
+// g++ -std=c++20 -O2 -I../include -I../extern bench_approx_math.cpp -o bench_approx_math
+//
+
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "clg-math/clg_math.hpp"
+#include "approx_math.hpp"
+
+volatile float sink; // keeps the timing loops from being optimized away
+
+constexpr int SampleCount = 1 << 20;
+
+struct samples
+{
+    std::vector<float> a;
+    std::vector<float> b;
+};
+
+// magnitudes seen by the tire model: speeds and forces from about 1e-4 to 1e5
+samples MakeSamples()
+{
+    std::mt19937 rng(20221);
+    std::uniform_real_distribution<float> exponent(-4.0f, 5.0f);
+    std::uniform_real_distribution<float> sign(-1.0f, 1.0f);
+    samples result;
+    result.a.resize(SampleCount);
+    result.b.resize(SampleCount);
+    for (int i = 0; i < SampleCount; i++)
+    {
+        result.a[i] = std::pow(10.0f, exponent(rng)) * (sign(rng) < 0.0f ? -1.0f : 1.0f);
+        result.b[i] = std::pow(10.0f, exponent(rng)) * (sign(rng) < 0.0f ? -1.0f : 1.0f);
+    }
+
+    return result;
+}
+
+template<typename function_type>
+double NanosecondsPerCall(const samples& s, function_type function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    float acc = 0.0f;
+    for (int i = 0; i < SampleCount; i++)
+    {
+        acc += function(s.a[i], s.b[i]);
+    }
+    sink = acc;
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / SampleCount;
+}
+
+void PrintRow(const char* name, double max_error, double mean_error, double ns, const char* kind)
+{
+    using namespace std;
+    cout << left << setw(16) << name
+        << right << setw(14) << scientific << setprecision(3) << max_error
+        << setw(14) << mean_error
+        << setw(10) << fixed << setprecision(2) << ns
+        << "  " << kind << "\n";
+}
+
+template<int newton_steps>
+void ReportRsqrt(const char* name, const samples& s)
+{
+    double max_error = 0.0;
+    double sum_error = 0.0;
+    for (int i = 0; i < SampleCount; i++)
+    {
+        const float x = std::abs(s.a[i]);
+        const double expected = 1.0 / std::sqrt(static_cast<double>(x));
+        const double error = std::abs(clg::approx::rsqrt<newton_steps>(x) - expected) / expected;
+        max_error = std::max(max_error, error);
+        sum_error += error;
+    }
+
+    const auto ns = NanosecondsPerCall(s, [](float a, float) { return clg::approx::rsqrt<newton_steps>(std::abs(a)); });
+    PrintRow(name, max_error, sum_error / SampleCount, ns, "relative");
+}
+
+template<typename function_type>
+void ReportAtan2(const char* name, const samples& s, function_type function)
+{
+    double max_error = 0.0;
+    double sum_error = 0.0;
+    for (int i = 0; i < SampleCount; i++)
+    {
+        const double expected = std::atan2(static_cast<double>(s.a[i]), static_cast<double>(s.b[i]));
+        const double error = std::abs(function(s.a[i], s.b[i]) - expected);
+        max_error = std::max(max_error, error);
+        sum_error += error;
+    }
+
+    const auto ns = NanosecondsPerCall(s, function);
+    PrintRow(name, max_error, sum_error / SampleCount, ns, "absolute (rad)");
+}
+
+int main()
+{
+    using namespace std;
+
+    const auto s = MakeSamples();
+
+    cout << left << setw(16) << "function"
+        << right << setw(14) << "max error"
+        << setw(14) << "mean error"
+        << setw(10) << "ns/call" << "\n";
+
+    ReportRsqrt<0>("rsqrt<0>", s);
+    ReportRsqrt<1>("rsqrt<1>", s);
+    ReportRsqrt<2>("rsqrt<2>", s);
+    PrintRow("1/sqrtf", 0.0, 0.0, NanosecondsPerCall(s, [](float a, float) { return 1.0f / std::sqrt(std::abs(a)); }), "reference");
+
+    ReportAtan2("atan2_lookup", s, [](float y, float x) { return clg::approx::atan2_lookup(y, x); });
+    ReportAtan2("atan2_poly", s, [](float y, float x) { return clg::approx::atan2_poly(y, x); });
+    PrintRow("atan2f", 0.0, 0.0, NanosecondsPerCall(s, [](float y, float x) { return std::atan2(y, x); }), "reference");
+
+    return 0;
+}
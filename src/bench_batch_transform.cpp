@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Host-side timing of the sprite corner setup: batch_transform.hpp's kernels over a frame's worth of
+// sprites versus the per-sprite setup in BlitTransformedAlphaTexturedRectangle, and the largest corner
+// difference between the two.
+//
+// build command:
+// g++ -std=c++20 -O2 -I../include -I../extern bench_batch_transform.cpp -o bench_batch_transform
+//
+
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "clg-math/clg_math.hpp"
+#include "sin_table.hpp"
+#include "batch_transform.hpp"
+
+volatile float sink; // keeps the timing loops from being optimized away
+
+constexpr int SpriteCount = 65; // every car body on the track, as in game::DrawBodySprites()
+constexpr int TimingPasses = 20000;
+
+struct sprites
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> width;
+    std::vector<float> height;
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> angles;
+};
+
+// car bodies around the screen at any angle
+sprites MakeSprites()
+{
+    std::mt19937 rng(20221);
+    std::uniform_real_distribution<float> x(-80.0f, 480.0f);
+    std::uniform_real_distribution<float> y(-80.0f, 320.0f);
+    std::uniform_real_distribution<float> size(8.0f, 64.0f);
+    std::uniform_real_distribution<float> angle(-4.0f * clg::trig<float>::pi, 4.0f * clg::trig<float>::pi);
+    sprites result;
+    for (int i = 0; i < SpriteCount; i++)
+    {
+        result.x.push_back(x(rng));
+        result.y.push_back(y(rng));
+        result.width.push_back(size(rng));
+        result.height.push_back(size(rng));
+        result.center_x.push_back(result.width.back() / 2.0f);
+        result.center_y.push_back(result.height.back() / 2.0f);
+        result.angles.push_back(angle(rng));
+    }
+
+    return result;
+}
+
+struct corners
+{
+    std::vector<float> x[4];
+    std::vector<float> y[4];
+
+    corners()
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            x[i].resize(SpriteCount);
+            y[i].resize(SpriteCount);
+        }
+    }
+};
+
+// the setup in BlitTransformedAlphaTexturedRectangle, one sprite at a time
+void TransformScalar(const sprites& s, corners& out)
+{
+    for (int i = 0; i < SpriteCount; i++)
+    {
+        const auto rotation = clg::sincos(s.angles[i]);
+        const float l = -s.center_x[i];
+        const float r = s.width[i] - s.center_x[i];
+        const float b = -s.center_y[i];
+        const float t = s.height[i] - s.center_y[i];
+        const float xs[4] = { l, r, l, r };
+        const float ys[4] = { b, b, t, t };
+        for (int corner = 0; corner < 4; corner++)
+        {
+            out.x[corner][i] = xs[corner] * rotation.c - ys[corner] * rotation.s + s.x[i];
+            out.y[corner][i] = xs[corner] * rotation.s + ys[corner] * rotation.c + s.y[i];
+        }
+    }
+}
+
+// the setup in game::DrawBodySprites()
+void TransformBatch(const sprites& s, clg::brad* brads, float* sines, float* cosines, corners& out)
+{
+    clg::to_brad_batch(s.angles.data(), brads, SpriteCount);
+    clg::sincos_batch(brads, sines, cosines, SpriteCount);
+
+    const clg::quad_batch_input in = { s.x.data(), s.y.data(), s.width.data(), s.height.data(), s.center_x.data(), s.center_y.data(), sines, cosines };
+    const clg::quad_batch_output batch_out =
+    {
+        { out.x[0].data(), out.x[1].data(), out.x[2].data(), out.x[3].data() },
+        { out.y[0].data(), out.y[1].data(), out.y[2].data(), out.y[3].data() },
+    };
+    clg::transform_quad_batch(in, batch_out, SpriteCount);
+}
+
+template<typename function_type>
+double NanosecondsPerSprite(function_type function, const corners& out)
+{
+    const auto start = std::chrono::steady_clock::now();
+    float acc = 0.0f;
+    for (int pass = 0; pass < TimingPasses; pass++)
+    {
+        function();
+        acc += out.x[pass & 3][pass % SpriteCount];
+    }
+    sink = acc;
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (static_cast<double>(TimingPasses) * SpriteCount);
+}
+
+int main()
+{
+    using namespace std;
+
+    const auto s = MakeSprites();
+    corners scalar_corners;
+    corners batch_corners;
+    vector<clg::brad> brads(SpriteCount);
+    vector<float> sines(SpriteCount);
+    vector<float> cosines(SpriteCount);
+
+    TransformScalar(s, scalar_corners);
+    TransformBatch(s, brads.data(), sines.data(), cosines.data(), batch_corners);
+    double max_difference = 0.0;
+    for (int corner = 0; corner < 4; corner++)
+    {
+        for (int i = 0; i < SpriteCount; i++)
+        {
+            max_difference = max<double>(max_difference, abs(scalar_corners.x[corner][i] - batch_corners.x[corner][i]));
+            max_difference = max<double>(max_difference, abs(scalar_corners.y[corner][i] - batch_corners.y[corner][i]));
+        }
+    }
+
+    const auto scalar_ns = NanosecondsPerSprite([&]() { TransformScalar(s, scalar_corners); }, scalar_corners);
+    const auto batch_ns = NanosecondsPerSprite([&]() { TransformBatch(s, brads.data(), sines.data(), cosines.data(), batch_corners); }, batch_corners);
+
+    cout << left << setw(16) << "setup"
+        << right << setw(12) << "ns/sprite" << "\n";
+    cout << left << setw(16) << "per sprite"
+        << right << setw(12) << fixed << setprecision(2) << scalar_ns << "\n";
+    cout << left << setw(16) << "batched"
+        << right << setw(12) << batch_ns << "\n";
+    cout << "max corner difference: " << scientific << setprecision(3) << max_difference << " pixels\n";
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Host-side accuracy and speed report for the compile-time sine tables versus std::sin.
+//
+// build command:
+// g++ -std=c++20 -O2 -I../include -I../extern bench_trig.cpp -o bench_trig
+//
+
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "clg-math/clg_math.hpp"
+#include "sin_table.hpp"
+
+volatile float sink; // keeps the timing loops from being optimized away
+
+constexpr int BradCount = 65536;
+constexpr int TimingPasses = 200;
+
+template<typename element_type>
+inline double to_double(element_type value)
+{
+    if constexpr (std::is_same_v<element_type, clg::q15>)
+        return value / 32768.0;
+    else
+        return value;
+}
+
+template<int quarter_bits, typename element_type, bool interpolate>
+void Report(const char* name)
+{
+    using namespace std;
+    static constexpr clg::sine_lookup<quarter_bits, element_type, interpolate> table;
+
+    // accuracy over every representable angle
+    double max_error = 0.0;
+    double sum_squared_error = 0.0;
+    for (int i = 0; i < BradCount; i++)
+    {
+        const auto angle = static_cast<clg::brad>(i);
+        const double expected = std::sin(clg::trig<double>::two_pi * i / BradCount);
+        const double error = std::abs(to_double(table.sin(angle)) - expected);
+        max_error = std::max(max_error, error);
+        sum_squared_error += error * error;
+    }
+
+    // speed
+    const auto start = chrono::steady_clock::now();
+    float acc = 0.0f;
+    for (int pass = 0; pass < TimingPasses; pass++)
+    {
+        for (int i = 0; i < BradCount; i += 7)
+        {
+            acc += static_cast<float>(table.sin(static_cast<clg::brad>(i * 13 + pass)));
+        }
+    }
+    sink = acc;
+    const auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    const auto calls = static_cast<double>(TimingPasses) * ((BradCount + 6) / 7);
+
+    cout << left << setw(24) << name
+        << right << setw(8) << sizeof(table)
+        << setw(14) << scientific << setprecision(3) << max_error
+        << setw(14) << sqrt(sum_squared_error / BradCount)
+        << setw(10) << fixed << setprecision(2) << elapsed / calls << "\n";
+}
+
+void ReportStdSin()
+{
+    using namespace std;
+    constexpr float rad_per_brad = clg::trig<float>::two_pi / BradCount;
+    const auto start = chrono::steady_clock::now();
+    float acc = 0.0f;
+    for (int pass = 0; pass < TimingPasses; pass++)
+    {
+        for (int i = 0; i < BradCount; i += 7)
+        {
+            acc += std::sin(static_cast<clg::brad>(i * 13 + pass) * rad_per_brad);
+        }
+    }
+    sink = acc;
+    const auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    const auto calls = static_cast<double>(TimingPasses) * ((BradCount + 6) / 7);
+
+    cout << left << setw(24) << "std::sin (float)"
+        << right << setw(8) << 0
+        << setw(14) << "-"
+        << setw(14) << "-"
+        << setw(10) << fixed << setprecision(2) << elapsed / calls << "\n";
+}
+
+int main()
+{
+    using namespace std;
+
+    cout << left << setw(24) << "table"
+        << right << setw(8) << "bytes"
+        << setw(14) << "max error"
+        << setw(14) << "rms error"
+        << setw(10) << "ns/call" << "\n";
+
+    Report<6, float, false>("6 float");
+    Report<6, float, true>("6 float lerp");
+    Report<8, float, false>("8 float");
+    Report<8, float, true>("8 float lerp");
+    Report<9, float, false>("9 float");
+    Report<9, float, true>("9 float lerp");
+    Report<10, float, false>("10 float");
+    Report<12, float, false>("12 float");
+    Report<6, clg::q15, false>("6 q15");
+    Report<6, clg::q15, true>("6 q15 lerp");
+    Report<8, clg::q15, false>("8 q15");
+    Report<8, clg::q15, true>("8 q15 lerp");
+    Report<10, clg::q15, false>("10 q15");
+    ReportStdSin();
+
+    return 0;
+}
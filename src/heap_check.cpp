@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Host-side steady state heap check: loads the game's race_simulation into a level arena, marks the level
+// loaded, then runs its fixed updates with the player's car flat out, rewinding now and then. Any heap
+// allocation after the level loaded (operator new or Box2D's heap fallback) makes it exit with a non-zero
+// status.
+//
+// build command:
+// g++ -std=c++20 -O2 -DB2_USER_SETTINGS -DCLG_HEAP_TRACKING=1 -I../include -I../extern -I../extern/box2d/include -I$PLAYDATE_SDK_PATH/C_API heap_check.cpp b2_user_settings.cpp ../extern/box2d/src/*/*.cpp -o heap_check
+//
+// usage: heap_check [tick count]
+//
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <chrono>
+#include <iostream>
+#include "clg-math/clg_math.hpp"
+#include "box2d/box2d.h"
+#include "memory.hpp"
+#include "heap_tracker.hpp"
+#include "tlsf.hpp"
+#include "race_simulation.hpp"
+
+#if !CLG_HEAP_TRACKING
+#error "heap_check needs CLG_HEAP_TRACKING"
+#endif
+
+// NOTE: src/pd.cpp isn't linked in, so the Playdate hooks and the heap plumbing it defines go straight to
+//  the host here. src/b2_user_settings.cpp is, so Box2D's heap fallback is tracked as on the device.
+namespace
+{
+void* HostRealloc(void* ptr, size_t size)
+{
+    if (0 == size)
+    {
+        std::free(ptr);
+        return nullptr;
+    }
+
+    return std::realloc(ptr, size);
+}
+
+const auto startTime = std::chrono::steady_clock::now();
+
+float HostGetElapsedTime()
+{
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void HostLogToConsole(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    pd::logToConsoleVaList(format, args);
+    va_end(args);
+}
+} // namespace
+
+decltype(playdate_sys::realloc) pd::realloc = &HostRealloc;
+decltype(playdate_sys::logToConsole) pd::logToConsole = &HostLogToConsole;
+decltype(playdate_sys::error) pd::error = &HostLogToConsole;
+decltype(playdate_sys::getElapsedTime) pd::getElapsedTime = &HostGetElapsedTime;
+
+void pd::logToConsoleVaList(const char* format, va_list args)
+{
+    std::vfprintf(stderr, format, args);
+    std::fputc('\n', stderr);
+}
+
+namespace clg
+{
+heap_tracker global_heap_tracker;
+tlsf_heap* p_global_heap = nullptr;
+
+void* heap_alloc(size_t size)
+{
+    return std::malloc(size);
+}
+
+void heap_free(void* ptr)
+{
+    std::free(ptr);
+}
+} // namespace clg
+
+void* operator new(std::size_t count)
+{
+    clg::global_heap_tracker.record_allocation(count, "operator new");
+    const auto pTemp = clg::heap_alloc(count);
+    if (nullptr == pTemp)
+    {
+        throw std::bad_alloc();
+    }
+
+    return pTemp;
+}
+
+void* operator new(std::size_t count, const std::nothrow_t&) noexcept
+{
+    clg::global_heap_tracker.record_allocation(count, "operator new");
+    return clg::heap_alloc(count);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (nullptr != ptr)
+    {
+        clg::global_heap_tracker.record_free();
+        clg::heap_free(ptr);
+    }
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+constexpr float FixedDeltaTime = 0.02f; // as clg::fixedUpdateDeltaT
+constexpr int DefaultTickCount = 3000; // a minute of game time
+constexpr int RewindInterval = 500; // ticks between rewinds
+constexpr int RewindDistance = 100; // frames rewound
+
+int main(int argc, char* argv[])
+{
+    using namespace std;
+
+    const auto tickCount = argc > 1 ? atoi(argv[1]) : DefaultTickCount;
+
+    clg::memory_arena levelArena;
+    if (0 == levelArena.initialize(clg::race_simulation::level_heap_size))
+    {
+        cerr << "ERROR: failed to create the level heap\n";
+        return 1;
+    }
+
+    // as game::StartUp(), minus the textures
+    clg::race_simulation race(levelArena);
+    auto pSurfaceCells = static_cast<clg::surface_id*>(levelArena.alloc(clg::race_simulation::get_surface_byte_count(), CLG_ARENA_TAG("surfaces")));
+    if (!race.initialize() || nullptr == pSurfaceCells)
+    {
+        cerr << "ERROR: failed to load the level\n";
+        return 1;
+    }
+
+    race.set_surface_cells(pSurfaceCells);
+    race.paint_surfaces();
+
+    const auto loadCounts = clg::global_heap_tracker.get_total_counts();
+    clg::global_heap_tracker.mark_level_loaded();
+
+    uint32_t checksum = 0;
+    for (int tick = 0; tick < tickCount; tick++)
+    {
+        clg::global_heap_tracker.begin_frame();
+
+        // as game::FixedUpdate() and game::UpdateRewind()
+        race.set_player_control(clg::Tire::ControlState::Up);
+        race.fixed_update(FixedDeltaTime);
+        checksum = race.get_checksum();
+        if (0 == (tick + 1) % RewindInterval)
+        {
+            auto& rewindFrames = race.get_rewind_frames();
+            for (int i = 0; i < RewindDistance && rewindFrames.size() > 1; i++)
+            {
+                rewindFrames.pop_back();
+            }
+
+            race.restore_rewind_frame(rewindFrames.back());
+        }
+    }
+
+    const auto& totalCounts = clg::global_heap_tracker.get_total_counts();
+    const auto& regionStats = race.get_physics_allocator().get_stats();
+    cout << "loading: " << loadCounts.allocation_count << " heap allocations, " << loadCounts.allocated_bytes << " bytes\n";
+    cout << tickCount << " ticks: " << totalCounts.allocation_count - loadCounts.allocation_count << " heap allocations, "
+        << totalCounts.allocated_bytes - loadCounts.allocated_bytes << " bytes; physics region "
+        << regionStats.used_page_count << " pages used; checksum " << hex << checksum << dec << "\n";
+
+    const auto violationCount = clg::global_heap_tracker.get_violation_count();
+    if (0 != violationCount)
+    {
+        cerr << "FAILED: " << violationCount << " heap allocations after the level loaded\n";
+        return 1;
+    }
+
+    cout << "PASSED\n";
+    return 0;
+}
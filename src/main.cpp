@@ -14,8 +14,21 @@
 #include "box2d/box2d.h"
 #include "sin_table.hpp"
 #include "memory.hpp"
+#include "fixed_point.hpp"
 #include "drawing.hpp"
+#include "batch_transform.hpp"
+#include "decal_layer.hpp"
+#include "size_class_allocator.hpp"
+#include "heap_tracker.hpp"
+#include "arena_snapshot.hpp"
+#include "tlsf.hpp"
 #include "car_physics.hpp"
+#include "containers.hpp"
+#include "vehicle_system.hpp"
+#include "input_recorder.hpp"
+#include "physics_budget.hpp"
+#include "surface_map.hpp"
+#include "race_simulation.hpp"
 
 namespace clg
 {
@@ -33,7 +46,6 @@ using PaintTextureFunc = void (*)(uint8_t* pCanvas, int width, int height);
 float elapsedFrameTime;
 
 clg::point p;
-float step;
 uint8_t* pHollowRectangle;
 uint8_t* pTriangle;
 uint8_t* pCheckerboard;
@@ -48,99 +60,112 @@ float fps;
 
 auto timerTotal = 0.0f;
 auto timerCount = 0;
-b2World* pWorldPhysics = nullptr;
-clg::Car* pCarSim = nullptr;
+clg::race_simulation* pRace = nullptr;
 clg::memory_arena* pLevelArena = nullptr;
-clg::memory_arena* pFrameArena = nullptr;
+clg::double_buffered_arena* pFrameArenas = nullptr;
+clg::memory_arena* pFrameArena = nullptr; // this frame's half of pFrameArenas
+clg::tlsf_heap* pGeneralHeap = nullptr;
+clg::surface_id* pSurfaceCells = nullptr; // part of the level snapshot
 
-bool InitializePhysics()
+constexpr float PixelsPerMeter = clg::race_simulation::pixels_per_meter;
+clg::pointi camera; // world pixel at the bottom-left of the display
+
+// Box2D body transforms at the last two fixed updates; rendering blends between them
+struct InterpolatedBody
 {
-    b2Vec2 gravity(0.0f, 0.0f);
-    pWorldPhysics = new (std::nothrow) b2World(gravity);
-    if (nullptr == pWorldPhysics)
-    {
-        pd::error("ERROR: failed to allocated memory for world physics");
-        return false;
-    }
+    b2Body* pBody;
+    b2Vec2 previousPosition;
+    b2Vec2 currentPosition;
+    float previousAngle;
+    float currentAngle;
+};
+
+constexpr int CarBodyCount = 5; // chassis followed by the tires
+InterpolatedBody carBodies[clg::race_simulation::max_car_count][CarBodyCount]; // by the car record's vehicle index
+
+// A frame's body sprites as structure-of-arrays, so their corners are set up by one transform_quad_batch()
+// before any is rasterized. Every sprite is a 100x100 texture stretched over its body.
+constexpr int MaxBodySpriteCount = clg::race_simulation::max_car_count * CarBodyCount;
+struct BodySprites
+{
+    const uint8_t* pTextures[MaxBodySpriteCount];
+    float x[MaxBodySpriteCount];        // body center on screen
+    float y[MaxBodySpriteCount];
+    float width[MaxBodySpriteCount];    // body size on screen
+    float height[MaxBodySpriteCount];
+    float centerX[MaxBodySpriteCount];  // half the size; the sprites rotate around the body center
+    float centerY[MaxBodySpriteCount];
+    float angles[MaxBodySpriteCount];   // radians
+    clg::brad brads[MaxBodySpriteCount];
+    float sines[MaxBodySpriteCount];
+    float cosines[MaxBodySpriteCount];
+    float cornerX[4][MaxBodySpriteCount];
+    float cornerY[4][MaxBodySpriteCount];
+    int count;
+};
+
+BodySprites bodySprites;
+
+clg::input_sample pendingInput; // sampled every frame by ProcessInput(), consumed by FixedUpdate()
+
+// NOTE: A rewind while recording would leave ticks in the recording that never happened.
+constexpr bool IsRewindEnabled = !CLG_INPUT_RECORDING;
+constexpr float RewindCrankDegreesPerFrame = 6.0f;
+int rewindAge = -1; // frames back from the newest being shown; -1 when not rewinding
+float rewindCrank = 0.0f; // degrees turned that didn't add up to a whole frame yet
+
+// NOTE: Bump the version whenever the code that paints the level's textures changes.
+constexpr const char* LevelSnapshotPath = "level.snapshot";
+constexpr uint32_t LevelSnapshotVersion = 2;
+
+constexpr const char* InputRecordingPath = "input.rec";
+constexpr const char* InputChecksumPath = "input.sum";
+#if CLG_INPUT_RECORDING
+clg::input_recorder inputRecorder;
+#endif
+#if CLG_INPUT_REPLAY
+clg::input_player inputPlayer;
+#endif
 
-    b2Body* carBody;
-    {
-        b2BodyDef carBodyDef;
-        carBodyDef.type = b2BodyType::b2_dynamicBody;
-        carBody = pWorldPhysics->CreateBody(&carBodyDef);
-    }
-    // car fixture setup
-    {
-        b2PolygonShape carBox;
-        carBox.SetAsBox(1.143f, 2.286f);
-        b2FixtureDef carFixture;
-        carFixture.shape = &carBox;
-        carFixture.density = 1.0f; // TODO: make this more accurate???
-        carBody->CreateFixture(&carFixture);
-    }
-    // car mass
+void TrackBody(InterpolatedBody& tracked, b2Body* pBody)
+{
+    tracked.pBody = pBody;
+    tracked.previousPosition = tracked.currentPosition = pBody->GetPosition();
+    tracked.previousAngle = tracked.currentAngle = pBody->GetAngle();
+}
+
+// call after every physics step
+void SaveBodyTransforms()
+{
+    for (int carIndex = 0; carIndex < pRace->get_vehicles().get_car_count(); carIndex++)
+    for (auto& tracked : carBodies[carIndex])
     {
-        // massData.center = b2Vec2();
-        // massData.I = 0.0f; // TODO: before b2Body* is passed in?
-        auto massData = carBody->GetMassData();
-        massData.mass = (clg::Car::totalWeight - 4.0f * clg::Car::wheelWeight) / clg::formula::gravitationalAcceleration;
-        carBody->SetMassData(&massData);
+        tracked.previousPosition = tracked.currentPosition;
+        tracked.previousAngle = tracked.currentAngle;
+        tracked.currentPosition = tracked.pBody->GetPosition();
+        tracked.currentAngle = tracked.pBody->GetAngle();
     }
-    // tire bodies
-    const b2Vec2 tirePos[4] =
-    {
-        b2Vec2(-0.84455f,  1.47955f), b2Vec2(0.84455f,  1.47955f),
-        b2Vec2(-0.84455f, -1.47955f), b2Vec2(0.84455f, -1.47955f)
-    };
-    b2Body* tireBodies[4];
+}
+
+// blend the last two physics steps; ratio is how far the game clock is past the latest one (in steps)
+void GetInterpolatedTransform(const InterpolatedBody& tracked, float ratio, b2Vec2& position, float& angle)
+{
+    position = tracked.previousPosition + ratio * (tracked.currentPosition - tracked.previousPosition);
+    angle = tracked.previousAngle + ratio * (tracked.currentAngle - tracked.previousAngle);
+}
+
+// interpolate the bodies of every car for drawing
+void TrackCarBodies()
+{
+    for (const auto& car : pRace->get_cars())
     {
-        b2BodyDef tireBodyDef;
-        tireBodyDef.type = b2BodyType::b2_dynamicBody;
-        b2FixtureDef tireFixture; // 66.5inch track and 116.5inch wheelbase (0.84455m hx, 1.47955m hy)
-        b2PolygonShape tireBox; // 245/35R21 tires (245mm wide; 245mm * 0.35 sidewall; fit 21inch rims)
-        {
-            tireBox.SetAsBox(0.1225f, 0.309575f); // 533.4mm rim + (0.35 * 245mm tires) == 533.4mm + 85.75mm == 619.15mm == 0.61915m
-            tireFixture.shape = &tireBox;
-            tireFixture.density = 1.0f; // TODO: make this more accurate???
-        }
-        auto pTirePos = tirePos;
-        for (auto& pTireBody : tireBodies)
+        auto& bodies = carBodies[car.vehicle_index];
+        TrackBody(bodies[0], car.p_car->m_body);
+        for (int i = 0; i < 4; i++)
         {
-            tireBodyDef.position = *pTirePos++;
-            pTireBody = pWorldPhysics->CreateBody(&tireBodyDef);
-            pTireBody->CreateFixture(&tireFixture);
-            // tire mass
-            {
-                auto massData = pTireBody->GetMassData();
-                massData.mass = clg::Car::wheelWeight / clg::formula::gravitationalAcceleration;
-                pTireBody->SetMassData(&massData);
-            }
+            TrackBody(bodies[i + 1], car.p_car->m_tires[i].m_body);
         }
     }
-    // front wheel pivot joints
-    b2RevoluteJoint* wheelJoint[2];
-    for (int i = 0; i < 2; i++)
-    {
-        b2RevoluteJointDef jointDef;
-        jointDef.enableLimit = true;
-        jointDef.lowerAngle = clg::to_radians(-40.0f);
-        jointDef.upperAngle = clg::to_radians(40.0f);
-        jointDef.maxMotorTorque = 500.0f;
-        jointDef.Initialize(carBody, tireBodies[i], tirePos[i]);
-        wheelJoint[i] = static_cast<b2RevoluteJoint*>(pWorldPhysics->CreateJoint(&jointDef));
-    }
-
-    pCarSim = new (std::nothrow) clg::Car();
-    if (nullptr == pCarSim)
-    {
-        pd::error("ERROR: failed to allocate memory for vehicle physics simulation");
-        return false;
-    }
-
-    pCarSim->Initialize(carBody, tireBodies, wheelJoint);
-
-    // b2Log("test log from box2d %s %d %s...", "one", 2, "three");
-    return true;
 }
 
 void PaintHollowRectangle(uint8_t* pCanvas, int width, int height)
@@ -192,7 +217,8 @@ void PaintCheckerboard(uint8_t* pCanvas, int width, int height)
 uint8_t* CreateTexture(clg::memory_arena* pDstArena, clg::memory_arena* pTransientArena, int width, int height,
     const PaintTextureFunc PaintTexture, int& linePitch)
 {
-    auto pUncompressed = static_cast<uint8_t*>(pTransientArena->alloc(width * height));
+    clg::arena_scope transientScope(*pTransientArena); // the uncompressed copy is only needed until compression is done
+    auto pUncompressed = static_cast<uint8_t*>(pTransientArena->alloc(width * height, CLG_ARENA_TAG("uncompressed textures")));
     if (nullptr == pUncompressed)
     {
         pd::error("ERROR: failed to allocate enough memory to paint texture");
@@ -202,7 +228,7 @@ uint8_t* CreateTexture(clg::memory_arena* pDstArena, clg::memory_arena* pTransie
     PaintTexture(pUncompressed, width, height);
     const auto uncompressedLinePitch = width;
     const auto compressedLinePitch = clg::GetCompressedTextureLinePitch<sizeof(uint16_t), false>(width);
-    auto pCompressed = static_cast<uint8_t*>(pDstArena->aligned_alloc<pd::PageAlignment>(compressedLinePitch * height));
+    auto pCompressed = static_cast<uint8_t*>(pDstArena->aligned_alloc<pd::PageAlignment>(compressedLinePitch * height, CLG_ARENA_TAG("textures")));
     if (nullptr == pCompressed)
     {
         pd::error("ERROR: failed to allocate enough memory to compress texture");
@@ -219,7 +245,8 @@ uint8_t* CreateTexture(clg::memory_arena* pDstArena, clg::memory_arena* pTransie
 uint8_t* CreateTextureWithTransparency(clg::memory_arena* pDstArena, clg::memory_arena* pTransientArena, int width, int height,
     const PaintTextureFunc PaintTexture, int& linePitch)
 {
-    auto pUncompressed = static_cast<uint8_t*>(pTransientArena->alloc(width * height));
+    clg::arena_scope transientScope(*pTransientArena); // the uncompressed copy is only needed until compression is done
+    auto pUncompressed = static_cast<uint8_t*>(pTransientArena->alloc(width * height, CLG_ARENA_TAG("uncompressed textures")));
     if (nullptr == pUncompressed)
     {
         pd::error("ERROR: failed to allocate enough memory to paint texture");
@@ -229,7 +256,7 @@ uint8_t* CreateTextureWithTransparency(clg::memory_arena* pDstArena, clg::memory
     PaintTexture(pUncompressed, width, height);
     const auto uncompressedLinePitch = width;
     const auto compressedLinePitch = clg::GetCompressedTextureLinePitch<sizeof(uint16_t), true>(width);
-    auto pCompressed = static_cast<uint8_t*>(pDstArena->aligned_alloc<pd::PageAlignment>(compressedLinePitch * height));
+    auto pCompressed = static_cast<uint8_t*>(pDstArena->aligned_alloc<pd::PageAlignment>(compressedLinePitch * height, CLG_ARENA_TAG("textures")));
     if (nullptr == pCompressed)
     {
         pd::error("ERROR: failed to allocate enough memory to compress texture");
@@ -246,29 +273,38 @@ void StartUp()
     // Initialize Globals
     /////////////////////
     elapsedFrameTime = 0.0f;
-    p = clg::point(200.0f, 120.0f);
-    step = 100.0f;
-    b2Scale = clg::sizev(2.0f);
+    p = clg::point(350.0f, 50.0f); // test sprite in the bottom-right corner; the car is centered
+    b2Scale = clg::sizev(0.75f);
     b2Angle = 0.0f;
     cycle = 0.0f;
     held = static_cast<PDButtons>(0);
     ups = 0.0f;
     fps = 0.0f;
+    pendingInput = clg::input_sample();
+    camera = clg::pointi(-pd::LcdWidth / 2, -pd::LcdHeight / 2);
 
     clg::InitializeDrawing();
 
-    auto isPhysicsInitialized = InitializePhysics();
-    if (!isPhysicsInitialized)
+    // take the general purpose heap from the system once; operator new and Box2D's overflow use it from here on
     {
-        // TODO: some sort of error screen
-        return;
+        constexpr size_t GeneralHeapSize = 512u * 1024u;
+        auto pGeneralHeapMemory = pd::realloc(nullptr, GeneralHeapSize);
+        pGeneralHeap = new (std::nothrow) clg::tlsf_heap();
+        if (nullptr == pGeneralHeapMemory || nullptr == pGeneralHeap || !pGeneralHeap->initialize(pGeneralHeapMemory, GeneralHeapSize))
+        {
+            pd::error("ERROR: failed to create the general purpose heap");
+            return;
+        }
+
+        clg::p_global_heap = pGeneralHeap;
+        pd::logToConsole("memory allocated for general heap = %d", GeneralHeapSize);
     }
 
     // allocate memory per frame memory arena
     {
         pLevelArena = new (std::nothrow) clg::memory_arena(); // current level heap
-        pFrameArena = new (std::nothrow) clg::memory_arena(); // per frame heap
-        if (nullptr == pLevelArena || nullptr == pFrameArena)
+        pFrameArenas = new (std::nothrow) clg::double_buffered_arena(); // per frame heaps (this frame and last)
+        if (nullptr == pLevelArena || nullptr == pFrameArenas)
         {
             pd::error("ERROR: failed to memory arena object");
             // TODO: error message splash screen
@@ -276,8 +312,9 @@ void StartUp()
         }
 
         // largest size allocated was (after physics and test textures): 16,294,156 (15.53MB)
-        size_t levelHeapSize = 8u * 1024u * 1024u;
-        size_t frameHeapSize = 6u * 1024u * 1024u;
+        // NOTE: Build with CLG_ARENA_INSTRUMENTATION=1 and pause the game to write measured sizes to arena_stats.txt.
+        size_t levelHeapSize = clg::race_simulation::level_heap_size;
+        size_t frameHeapSize = 3u * 1024u * 1024u; // x2
         levelHeapSize = pLevelArena->initialize(levelHeapSize);
         if (0 == levelHeapSize)
         {
@@ -286,7 +323,7 @@ void StartUp()
             return;
         }
 
-        frameHeapSize = pFrameArena->initialize(frameHeapSize);
+        frameHeapSize = pFrameArenas->initialize(frameHeapSize);
         if (0 == frameHeapSize)
         {
             pd::error("ERROR: failed to allocate memory pool for frame heap");
@@ -294,28 +331,232 @@ void StartUp()
             return;
         }
 
+        pFrameArena = &pFrameArenas->current();
+
         pd::logToConsole("memory allocated for level heap = %d", levelHeapSize);
-        pd::logToConsole("memory allocated for frame heap = %d", frameHeapSize);
+        pd::logToConsole("memory allocated for frame heaps = 2 x %d", frameHeapSize);
     }
 
-    // create some test textures
+    // the cars and the world they drive in; everything Box2D allocates lives in a region of the level heap
     {
-        pHollowRectangle = CreateTextureWithTransparency(pLevelArena, pFrameArena, 100, 100, &PaintHollowRectangle, compressedLinePitchWithTransparency);
-        pTriangle = CreateTextureWithTransparency(pLevelArena, pFrameArena, 100, 100, &PaintTriangle, compressedLinePitchWithTransparency);
-        pCheckerboard = CreateTextureWithTransparency(pLevelArena, pFrameArena, 100, 100, &PaintCheckerboard, compressedLinePitchWithTransparency);
+        pRace = new (std::nothrow) clg::race_simulation(*pLevelArena);
+        if (nullptr == pRace || !pRace->initialize())
+        {
+            // TODO: some sort of error screen
+            return;
+        }
+
+        pRace->get_physics_budget().set_adaptive(!CLG_INPUT_RECORDING && !CLG_INPUT_REPLAY); // replays need the same iterations every run
+        TrackCarBodies();
+
+        const auto& stats = pRace->get_physics_allocator().get_stats();
+        pd::logToConsole("physics memory in use = %d (%d pages, %d heap allocations)",
+            stats.bytes_in_use, stats.used_page_count, stats.heap_allocation_count);
     }
+
+    // create some test textures and the track surfaces; built once, then loaded from a snapshot of the level heap
+    {
+        clg::arena_snapshot levelSnapshot(LevelSnapshotVersion);
+        levelSnapshot.add_root(&pHollowRectangle);
+        levelSnapshot.add_root(&pTriangle);
+        levelSnapshot.add_root(&pCheckerboard);
+        levelSnapshot.add_root(&pSurfaceCells);
+        if (levelSnapshot.load(*pLevelArena, LevelSnapshotPath))
+        {
+            compressedLinePitchWithTransparency = clg::GetCompressedTextureLinePitch<sizeof(uint16_t), true>(100);
+            pRace->set_surface_cells(pSurfaceCells);
+            pd::logToConsole("loaded %s", LevelSnapshotPath);
+        }
+        else
+        {
+            levelSnapshot.begin(*pLevelArena);
+            pHollowRectangle = CreateTextureWithTransparency(pLevelArena, pFrameArena, 100, 100, &PaintHollowRectangle, compressedLinePitchWithTransparency);
+            pTriangle = CreateTextureWithTransparency(pLevelArena, pFrameArena, 100, 100, &PaintTriangle, compressedLinePitchWithTransparency);
+            pCheckerboard = CreateTextureWithTransparency(pLevelArena, pFrameArena, 100, 100, &PaintCheckerboard, compressedLinePitchWithTransparency);
+            pSurfaceCells = static_cast<clg::surface_id*>(pLevelArena->alloc(clg::race_simulation::get_surface_byte_count(), CLG_ARENA_TAG("surfaces")));
+            if (nullptr == pHollowRectangle || nullptr == pTriangle || nullptr == pCheckerboard || nullptr == pSurfaceCells)
+            {
+                pd::error("ERROR: failed to allocate memory for the level");
+                return;
+            }
+
+            pRace->set_surface_cells(pSurfaceCells);
+            pRace->paint_surfaces();
+            levelSnapshot.save(*pLevelArena, LevelSnapshotPath);
+        }
+    }
+
+    rewindAge = -1;
+
+#if CLG_HEAP_TRACKING
+    // everything the level needs is allocated; the frame loop must not touch the heap from here on
+    clg::global_heap_tracker.mark_level_loaded();
+#endif
+}
+
+#if CLG_ARENA_INSTRUMENTATION
+// write the arena usage statistics to the game's data folder
+void DumpArenaStats()
+{
+    if (nullptr == pLevelArena || nullptr == pFrameArenas)
+    {
+        return;
+    }
+
+    auto file = pd::open("arena_stats.txt", kFileWrite);
+    if (nullptr == file)
+    {
+        pd::logToConsole("ERROR: failed to open arena_stats.txt: %s", pd::geterr());
+        return;
+    }
+
+    pLevelArena->write_stats(file, "level");
+    pFrameArenas->write_stats(file, "frame");
+    pd::close(file);
+    pd::logToConsole("wrote arena_stats.txt");
+
+    const auto heapStats = pGeneralHeap->get_stats();
+    pd::logToConsole("general heap: used = %d, free = %d, largest free block = %d, fragmentation = %d%%",
+        heapStats.used_size, heapStats.free_size, heapStats.largest_free_size, static_cast<int>(heapStats.fragmentation() * 100.0f));
+}
+#endif // CLG_ARENA_INSTRUMENTATION
+
+void RestoreRewindFrame(const clg::race_simulation::rewind_frame& frame)
+{
+    pRace->restore_rewind_frame(frame);
+
+    // no blending from wherever the bodies were before
+    SaveBodyTransforms();
+    SaveBodyTransforms();
+}
+
+// While A and B are both held, the game stops and the crank scrubs back (counter-clockwise) and forward
+// through the last few seconds. Letting go carries on from the frame shown; the frames after it are gone.
+// Returns true while rewinding.
+bool UpdateRewind()
+{
+    constexpr auto RewindButtons = kButtonA | kButtonB;
+    auto& rewindFrames = pRace->get_rewind_frames();
+    const bool isRewinding = IsRewindEnabled && RewindButtons == (held & RewindButtons) && !rewindFrames.empty();
+    if (!isRewinding)
+    {
+        for (; rewindAge > 0; rewindAge--)
+        {
+            rewindFrames.pop_back();
+        }
+
+        rewindAge = -1;
+        return false;
+    }
+
+    if (rewindAge < 0)
+    {
+        rewindAge = 0;
+        rewindCrank = 0.0f;
+    }
+
+    // the crank is all the rewind's; none of it carries over to the next fixed update
+    rewindCrank += pendingInput.get_crank_degrees();
+    pendingInput.crank_change = 0;
+    const auto frameSteps = static_cast<int>(rewindCrank / RewindCrankDegreesPerFrame);
+    rewindCrank -= frameSteps * RewindCrankDegreesPerFrame;
+
+    const auto newestAge = static_cast<int>(rewindFrames.size()) - 1;
+    const auto age = std::clamp(rewindAge - frameSteps, 0, newestAge);
+    if (age != rewindAge)
+    {
+        rewindAge = age;
+        RestoreRewindFrame(rewindFrames[newestAge - rewindAge]);
+    }
+
+    return true;
+}
+
+// the only place input reaches the game, so recordings replay exactly
+void ApplyInput(const clg::input_sample& input, float fixedUpdateDeltaT)
+{
+    // the d-pad drives the car
+    int control = static_cast<int>(clg::Tire::ControlState::Neutral);
+    if (input.buttons & kButtonLeft)
+        control |= static_cast<int>(clg::Tire::ControlState::Left);
+    if (input.buttons & kButtonRight)
+        control |= static_cast<int>(clg::Tire::ControlState::Right);
+    if (input.buttons & kButtonDown)
+        control |= static_cast<int>(clg::Tire::ControlState::Down);
+    if (input.buttons & kButtonUp)
+        control |= static_cast<int>(clg::Tire::ControlState::Up);
+    pRace->set_player_control(static_cast<clg::Tire::ControlState>(control));
+
+    if (input.buttons & kButtonB)
+        b2Scale += fixedUpdateDeltaT;
+    if (input.buttons & kButtonA)
+        b2Scale -= fixedUpdateDeltaT;
+
+    if (0 != input.crank_change)
+        cycle -= clg::to_radians(input.get_crank_degrees());
+
+    cycle = clg::clamp_radians(cycle);
+    b2Angle = cycle;
 }
 
 void FixedUpdate(float elapsedFixedGameTimeInSeconds, float fixedUpdateDeltaT)
 {
     ups = (ups + 1.0f / fixedUpdateDeltaT) * 0.5f;
+
+    // the crank change accumulated since the last tick goes to this one
+    const auto input = pendingInput;
+    pendingInput.crank_change = 0;
+    ApplyInput(input, fixedUpdateDeltaT);
+
+    pRace->fixed_update(fixedUpdateDeltaT);
+    SaveBodyTransforms();
+
+#if CLG_INPUT_RECORDING
+    inputRecorder.record(input, pRace->get_checksum());
+#endif
 }
 
-void ProcessInput(float elapsedSeconds)
+#if CLG_INPUT_REPLAY
+// run the recorded session through the fixed updates as fast as possible, without drawing
+void RunInputReplay(float fixedUpdateDeltaT)
 {
-    float dx = 0.0f;
-    float dy = 0.0f;
+    if (!inputPlayer.open(InputRecordingPath, InputChecksumPath, fixedUpdateDeltaT))
+    {
+        return;
+    }
+
+    pd::resetElapsedTime();
+    while (inputPlayer.next(pendingInput))
+    {
+        FixedUpdate(pRace->get_fixed_update_count() * fixedUpdateDeltaT, fixedUpdateDeltaT);
+        inputPlayer.check(pRace->get_checksum());
+    }
+    const auto elapsed = pd::getElapsedTime();
+
+    const auto tickCount = inputPlayer.get_tick_count();
+    pd::logToConsole("replayed %d ticks in %d ms (%d us per tick, %d us per step)",
+        tickCount, static_cast<int>(elapsed * 1000.0f), 0 == tickCount ? 0 : static_cast<int>(elapsed * 1000000.0f / tickCount),
+        static_cast<int>(pRace->get_physics_budget().get_stats().average_step_time * 1000000.0f));
+    if (!inputPlayer.has_checksums())
+    {
+        pd::logToConsole("replay not checked: %s is missing", InputChecksumPath);
+    }
+    else if (inputPlayer.get_first_divergent_tick() >= 0)
+    {
+        pd::logToConsole("replay DIVERGED at tick %d", inputPlayer.get_first_divergent_tick());
+    }
+    else
+    {
+        pd::logToConsole("replay matched the recording");
+    }
+
+    inputPlayer.close();
+}
+#endif // CLG_INPUT_REPLAY
 
+// sample the buttons and crank for the next fixed update
+void ProcessInput()
+{
     PDButtons current = static_cast<PDButtons>(0);
     PDButtons pushed = static_cast<PDButtons>(0);
     PDButtons released = static_cast<PDButtons>(0);
@@ -323,37 +564,106 @@ void ProcessInput(float elapsedSeconds)
     held = static_cast<PDButtons>(held & ~released);
     held = static_cast<PDButtons>(held | pushed);
 
-    if (held & kButtonLeft)
-        dx -= elapsedSeconds * step;
-    if (held & kButtonRight)
-        dx += elapsedSeconds * step;
-    if (held & kButtonDown)
-        dy -= elapsedSeconds * step;
-    if (held & kButtonUp)
-        dy += elapsedSeconds * step;
+    // the crank keeps adding up over frames without a fixed update
+    pendingInput.buttons = static_cast<uint8_t>(held);
+    pendingInput.crank_change = clg::input_sample::quantize_crank(
+        pendingInput.get_crank_degrees() + pd::getCrankChange());
+}
+
+// queue a body of the given size for DrawBodySprites()
+void AddBodySprite(const uint8_t* pTexture, const clg::sizev& sizeInMeters, const b2Vec2& position, float angle)
+{
+    const float x = position.x * PixelsPerMeter - camera.x;
+    const float y = position.y * PixelsPerMeter - camera.y;
+
+    // skip bodies well off the screen
+    constexpr float Margin = 80.0f;
+    if (x < -Margin || y < -Margin || x > pd::LcdWidth + Margin || y > pd::LcdHeight + Margin)
+    {
+        return;
+    }
 
-    p += clg::point(dx, dy);
+    assert(bodySprites.count < MaxBodySpriteCount);
+    const auto i = bodySprites.count++;
+    bodySprites.pTextures[i] = pTexture;
+    bodySprites.x[i] = x;
+    bodySprites.y[i] = y;
+    bodySprites.width[i] = sizeInMeters.width * PixelsPerMeter;
+    bodySprites.height[i] = sizeInMeters.height * PixelsPerMeter;
+    bodySprites.centerX[i] = bodySprites.width[i] / 2.0f;
+    bodySprites.centerY[i] = bodySprites.height[i] / 2.0f;
+    bodySprites.angles[i] = angle;
+}
 
-    if (held & kButtonB)
-        b2Scale += elapsedSeconds;
-    if (held & kButtonA)
-        b2Scale -= elapsedSeconds;
+// set up the corners of every queued body at once, then rasterize them in the order they were added
+void DrawBodySprites()
+{
+    auto& sprites = bodySprites;
+    clg::to_brad_batch(sprites.angles, sprites.brads, sprites.count);
+    clg::sincos_batch(sprites.brads, sprites.sines, sprites.cosines, sprites.count);
 
-    const auto crank = pd::getCrankChange();
-    if (0 != crank)
-        cycle -= clg::to_radians(crank);
+    const clg::quad_batch_input in = { sprites.x, sprites.y, sprites.width, sprites.height, sprites.centerX, sprites.centerY, sprites.sines, sprites.cosines };
+    const clg::quad_batch_output out =
+    {
+        { sprites.cornerX[0], sprites.cornerX[1], sprites.cornerX[2], sprites.cornerX[3] },
+        { sprites.cornerY[0], sprites.cornerY[1], sprites.cornerY[2], sprites.cornerY[3] },
+    };
+    clg::transform_quad_batch(in, out, sprites.count);
 
-    cycle = clg::clamp_radians(cycle);
-    b2Angle = cycle;
+    const clg::recti src(0, 0, 100, 100);
+    for (int i = 0; i < sprites.count; i++)
+    {
+        clg::BlitTransformedAlphaTexturedQuad(
+            clg::point(sprites.cornerX[0][i], sprites.cornerY[0][i]),
+            clg::point(sprites.cornerX[1][i], sprites.cornerY[1][i]),
+            clg::point(sprites.cornerX[2][i], sprites.cornerY[2][i]),
+            clg::point(sprites.cornerX[3][i], sprites.cornerY[3][i]),
+            sprites.cosines[i], sprites.sines[i],
+            clg::sizev(sprites.width[i], sprites.height[i]),
+            src, sprites.pTextures[i], compressedLinePitchWithTransparency, false);
+    }
+
+    sprites.count = 0;
 }
 
 void FrameUpdate(float interpolationRatio, float frameTime)
 {
     elapsedFrameTime = frameTime;
 
+    // keep the player's car centered
+    b2Vec2 playerPosition;
+    float playerAngle;
+    const auto playerIndex = pRace->get_cars().get(pRace->get_player())->vehicle_index;
+    GetInterpolatedTransform(carBodies[playerIndex][0], interpolationRatio, playerPosition, playerAngle);
+    camera = clg::pointi(
+        static_cast<int>(std::round(playerPosition.x * PixelsPerMeter)) - pd::LcdWidth / 2,
+        static_cast<int>(std::round(playerPosition.y * PixelsPerMeter)) - pd::LcdHeight / 2);
+
     clg::ClearFrameBuffer();
     clg::ClearDebugDrawing();
 
+    // decals are drawn first so sprites end up on top of them
+    pRace->get_skid_marks().composite(clg::pFrameBuf, camera.x, camera.y);
+
+    // same sizes as the fixtures made by clg::Car::Create()
+    for (const auto& car : pRace->get_cars())
+    {
+        b2Vec2 bodyPositions[CarBodyCount];
+        float bodyAngles[CarBodyCount];
+        for (int i = 0; i < CarBodyCount; i++)
+        {
+            GetInterpolatedTransform(carBodies[car.vehicle_index][i], interpolationRatio, bodyPositions[i], bodyAngles[i]);
+        }
+
+        for (int i = 1; i < CarBodyCount; i++)
+        {
+            AddBodySprite(pCheckerboard, clg::sizev(2.0f * clg::Car::tireHalfWidth, 2.0f * clg::Car::tireHalfLength), bodyPositions[i], bodyAngles[i]);
+        }
+        AddBodySprite(pHollowRectangle, clg::sizev(2.0f * clg::Car::chassisHalfWidth, 2.0f * clg::Car::chassisHalfLength), bodyPositions[0], bodyAngles[0]);
+    }
+
+    DrawBodySprites();
+
     clg::recti src(0, 0, 100, 100);
 
     clg::point srcCenterOffset;
@@ -366,7 +676,8 @@ void FrameUpdate(float interpolationRatio, float frameTime)
 
     clg::sizev scale(b2Scale);
 
-    pd::resetElapsedTime();
+    // NOTE: don't reset the elapsed time here; clg::update() measures the frame time with it
+    const auto blitStartTime = pd::getElapsedTime();
 
     clg::BlitTransformedAlphaTexturedRectangle(
         dst,
@@ -379,7 +690,7 @@ void FrameUpdate(float interpolationRatio, float frameTime)
         true
         );
 
-    auto t = pd::getElapsedTime();
+    auto t = pd::getElapsedTime() - blitStartTime;
     pd::logToConsole("%d", (int)(t * 1000000.0f));
 
 //    clg::DrawAxisAlignedBitmap(
@@ -421,25 +732,44 @@ namespace clg
     extern "C" // NOTE: <- This is sometimes unnessesary with the -g compile switch?
     int update(void *userdata)
     {
-        const float MaxFrameTimeSeconds = 0.25f; // don't accumulate more than 0.25sec per frame
         bool flushDisplay = true;
 
         auto frameTime = pd::getElapsedTime();
         pd::resetElapsedTime();
-        if (frameTime > MaxFrameTimeSeconds)
-        {
-            frameTime = MaxFrameTimeSeconds;
-        }
 
+        // nothing in the frame arenas outlives the next frame
+        game::pFrameArenas->swap();
+        game::pFrameArena = &game::pFrameArenas->current();
+#if CLG_HEAP_TRACKING
+        clg::global_heap_tracker.begin_frame();
+#endif
         currentGameTimeInSeconds += frameTime;
         gameTimeAccumulator += frameTime;
 
-        game::ProcessInput(frameTime);
+        game::ProcessInput();
+        if (game::UpdateRewind())
+        {
+            // the game clock stands still while rewinding
+            currentGameTimeInSeconds -= frameTime;
+            gameTimeAccumulator = 0.0f;
+        }
 
+        int tickCount = 0;
         while (gameTimeAccumulator >= fixedUpdateDeltaT)
         {
+            if (!game::pRace->get_physics_budget().can_run_tick(tickCount, pd::getElapsedTime()))
+            {
+                // out of time; skip the whole steps left over so the game slows down instead of falling behind
+                const auto droppedTime = std::floor(gameTimeAccumulator / fixedUpdateDeltaT) * fixedUpdateDeltaT;
+                gameTimeAccumulator -= droppedTime;
+                currentGameTimeInSeconds -= droppedTime;
+                game::pRace->get_physics_budget().record_dropped_time(droppedTime);
+                break;
+            }
+
             game::FixedUpdate(currentGameTimeInSeconds, fixedUpdateDeltaT);
             gameTimeAccumulator -= fixedUpdateDeltaT;
+            tickCount++;
         }
 
         const auto currentSnapProgress = gameTimeAccumulator / fixedUpdateDeltaT;
@@ -479,9 +809,34 @@ extern "C" int eventHandler(PlaydateAPI* playdate, PDSystemEvent event, uint32_t
 
             // log the elapsed init time
             pd::logToConsole("startup seconds: %d", (int)(elapsed * 1000.0f));
+
+#if CLG_INPUT_REPLAY
+            game::RunInputReplay(clg::fixedUpdateDeltaT);
+            pd::resetElapsedTime();
+#endif
+#if CLG_INPUT_RECORDING
+            game::inputRecorder.open(game::InputRecordingPath, game::InputChecksumPath, clg::fixedUpdateDeltaT);
+#endif
         } break;
+#if CLG_ARENA_INSTRUMENTATION || CLG_INPUT_RECORDING
+        case kEventPause:
+        {
+#if CLG_ARENA_INSTRUMENTATION
+            game::DumpArenaStats();
+#endif // CLG_ARENA_INSTRUMENTATION
+#if CLG_INPUT_RECORDING
+            game::inputRecorder.flush();
+#endif
+        } break;
+#endif
         case kEventTerminate:
         {
+#if CLG_INPUT_RECORDING
+            game::inputRecorder.close();
+#endif
+#if CLG_ARENA_INSTRUMENTATION
+            game::DumpArenaStats();
+#endif // CLG_ARENA_INSTRUMENTATION
             pd::FinalizeGlobalVariables();
         } break;
     }
@@ -3,6 +3,8 @@
 #include <cassert>
 #include <cmath>
 #include "clg-math/clg_math.hpp"
+#include "heap_tracker.hpp"
+#include "tlsf.hpp"
 
 #if TARGET_PLAYDATE
 extern "C"
@@ -242,6 +244,46 @@ void FinalizeGlobalVariables() {} // NOP
 #endif // TARGET_PLAYDATE
 } // namespace pd
 
+namespace clg
+{
+#if CLG_HEAP_TRACKING
+heap_tracker global_heap_tracker;
+#endif
+
+tlsf_heap* p_global_heap = nullptr;
+
+// operator new hands out heap_alloc() memory as is
+static_assert(tlsf_heap::alignment >= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "the general heap must meet operator new's alignment");
+
+void* heap_alloc(size_t size)
+{
+    if (nullptr != p_global_heap)
+    {
+        const auto ptr = p_global_heap->alloc(size);
+        if (nullptr != ptr)
+        {
+            return ptr;
+        }
+
+        // heap_free() hands anything the heap doesn't own back to pd::realloc()
+        pd::logToConsole("WARNING: general heap is full; %u bytes from the system heap", static_cast<unsigned>(size));
+    }
+
+    return pd::realloc(nullptr, size);
+}
+
+void heap_free(void* ptr)
+{
+    if (nullptr != p_global_heap && p_global_heap->owns(ptr))
+    {
+        p_global_heap->free(ptr);
+        return;
+    }
+
+    pd::realloc(ptr, 0);
+}
+} // namespace clg
+
 #ifdef TARGET_PLAYDATE
 namespace std
 {
@@ -258,7 +300,10 @@ void* operator new(std::size_t count) noexcept(false)
 
 void* operator new(std::size_t count, const std::nothrow_t& tag) noexcept
 {
-    const auto pTemp = pd::realloc(nullptr, count);
+#if CLG_HEAP_TRACKING
+    clg::global_heap_tracker.record_allocation(count, "operator new");
+#endif
+    const auto pTemp = clg::heap_alloc(count);
     if (nullptr != pTemp)
     {
         pd::logToConsole("SUCCESS: allocated memory in global new operator: %u", count);
@@ -291,7 +336,10 @@ void operator delete(void* ptr) noexcept
         return;
     }
 
-    pd::realloc(ptr, 0);
+#if CLG_HEAP_TRACKING
+    clg::global_heap_tracker.record_free();
+#endif
+    clg::heap_free(ptr);
 }
 
 // NOTE: this is implicitly referenced by virtual destructors
@@ -304,7 +352,10 @@ void operator delete(void* ptr, std::size_t) noexcept
         return;
     }
 
-    pd::realloc(ptr, 0);
+#if CLG_HEAP_TRACKING
+    clg::global_heap_tracker.record_free();
+#endif
+    clg::heap_free(ptr);
 }
 
 #if TARGET_PLAYDATE
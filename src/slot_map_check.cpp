@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Host-side check of clg::slot_map: swap-back removal, stale handle rejection and retirement of a slot
+// whose generation has run out. Exits with a non-zero status if any check fails.
+//
+// build command:
+// g++ -std=c++20 -O2 -I../include -I../extern -I$PLAYDATE_SDK_PATH/C_API slot_map_check.cpp -o slot_map_check
+//
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "clg-math/clg_math.hpp"
+#include "memory.hpp"
+#include "slot_map.hpp"
+
+// NOTE: src/pd.cpp isn't linked in, so the Playdate hooks the arena uses go straight to the host here.
+namespace
+{
+void* HostRealloc(void* ptr, size_t size)
+{
+    if (0 == size)
+    {
+        std::free(ptr);
+        return nullptr;
+    }
+
+    return std::realloc(ptr, size);
+}
+
+void HostLogToConsole(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    std::vfprintf(stderr, format, args);
+    std::fputc('\n', stderr);
+    va_end(args);
+}
+
+int failureCount = 0;
+
+void Check(bool condition, const char* description)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << description << "\n";
+        failureCount++;
+    }
+}
+} // namespace
+
+decltype(playdate_sys::realloc) pd::realloc = &HostRealloc;
+decltype(playdate_sys::logToConsole) pd::logToConsole = &HostLogToConsole;
+decltype(playdate_sys::error) pd::error = &HostLogToConsole;
+
+constexpr uint32_t Capacity = 4;
+
+// removing from the middle moves the last element into the hole; every other handle still resolves
+void CheckSwapBackRemove(clg::memory_arena& arena)
+{
+    clg::slot_map<int> map;
+    Check(map.initialize(arena, Capacity), "initialize");
+
+    clg::slot_handle handles[Capacity];
+    for (uint32_t i = 0; i < Capacity; i++)
+    {
+        handles[i] = map.insert(static_cast<int>(i * 10));
+    }
+
+    Check(map.insert(99).is_null(), "insert into a full map returns the null handle");
+    Check(map.remove(handles[1]), "remove from the middle");
+    Check(3 == map.size(), "size after remove");
+    Check(30 == map[1], "the last element fills the hole");
+    Check(handles[3] == map.handle_at(1), "the moved element's handle follows it");
+    Check(nullptr != map.get(handles[3]) && 30 == *map.get(handles[3]), "the moved element resolves");
+    Check(nullptr != map.get(handles[0]) && 0 == *map.get(handles[0]), "an unmoved element resolves");
+    Check(nullptr != map.get(handles[2]) && 20 == *map.get(handles[2]), "an unmoved element resolves");
+
+    int sum = 0;
+    for (const auto value : map)
+    {
+        sum += value;
+    }
+
+    Check(50 == sum, "iteration covers exactly the remaining elements");
+    Check(map.remove(handles[3]) && map.remove(handles[2]) && map.remove(handles[0]), "remove the rest");
+    Check(map.empty(), "empty after removing everything");
+}
+
+// a removed element's handle stops resolving, even once its slot is reused
+void CheckStaleHandles(clg::memory_arena& arena)
+{
+    clg::slot_map<int> map;
+    Check(map.initialize(arena, Capacity), "initialize");
+
+    const auto removed = map.insert(1);
+    Check(map.remove(removed), "remove");
+    Check(!map.contains(removed), "a removed handle isn't contained");
+    Check(nullptr == map.get(removed), "a removed handle doesn't resolve");
+    Check(!map.remove(removed), "a removed handle can't be removed twice");
+
+    const auto reused = map.insert(2);
+    Check(reused.index() == removed.index(), "the freed slot is reused");
+    Check(reused.generation() != removed.generation(), "the reused slot has a new generation");
+    Check(nullptr == map.get(removed), "the old handle doesn't resolve to the new element");
+    Check(nullptr != map.get(reused) && 2 == *map.get(reused), "the new handle resolves");
+
+    Check(!map.contains(clg::null_slot_handle), "the null handle is never contained");
+    Check(!map.contains(clg::slot_handle::make(Capacity, 1)), "an out of range handle is never contained");
+
+    map.clear();
+    Check(nullptr == map.get(reused), "clear() makes every handle stale");
+}
+
+// a slot whose generation has run out is never handed out again, so no handle can ever alias
+void CheckGenerationRetirement(clg::memory_arena& arena)
+{
+    clg::slot_map<int> map;
+    Check(map.initialize(arena, 1), "initialize");
+
+    const auto first = map.insert(0);
+    auto handle = first;
+    for (uint32_t generation = handle.generation(); generation < clg::slot_handle::max_generation; generation++)
+    {
+        map.remove(handle);
+        handle = map.insert(static_cast<int>(generation));
+        if (handle.is_null() || handle.index() != first.index())
+        {
+            Check(false, "the slot is reused until its generation runs out");
+            return;
+        }
+    }
+
+    Check(clg::slot_handle::max_generation == handle.generation(), "the last generation is handed out");
+    Check(map.remove(handle), "remove the last generation");
+    Check(map.insert(1).is_null() && map.empty(), "the retired slot isn't handed out again");
+    Check(nullptr == map.get(first), "the first generation's handle doesn't resolve");
+    Check(nullptr == map.get(handle), "the last generation's handle doesn't resolve");
+}
+
+int main()
+{
+    using namespace std;
+
+    clg::memory_arena arena;
+    if (0 == arena.initialize(64 * 1024))
+    {
+        cerr << "ERROR: failed to create the arena\n";
+        return 1;
+    }
+
+    CheckSwapBackRemove(arena);
+    CheckStaleHandles(arena);
+    CheckGenerationRetirement(arena);
+
+    if (0 != failureCount)
+    {
+        cerr << failureCount << " checks failed\n";
+        return 1;
+    }
+
+    cout << "PASSED\n";
+    return 0;
+}
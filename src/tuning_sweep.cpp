@@ -0,0 +1,369 @@
+//
+// Copyright (c) 2022 Christopher Gassib
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Host-side handling sweep: every combination of the Car::Tuning values below drives each scripted
+// maneuver in its own headless b2World, spread across all cores, and the metrics are written as CSV.
+// The car runs through clg::vehicle_system, as in the game's fixed update.
+//
+// build command:
+// g++ -std=c++20 -O2 -pthread -DB2_USER_SETTINGS -I../include -I../extern -I../extern/box2d/include -I$PLAYDATE_SDK_PATH/C_API tuning_sweep.cpp ../extern/box2d/src/*/*.cpp -o tuning_sweep
+//
+// usage: tuning_sweep [output.csv] [thread count]
+//
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include "clg-math/clg_math.hpp"
+#include "box2d/box2d.h"
+#include "memory.hpp"
+#include "car_physics.hpp"
+#include "vehicle_system.hpp"
+
+// NOTE: Neither src/pd.cpp nor src/b2_user_settings.cpp is linked in (they replace the global operator
+//  new with the Playdate's heap), so the few hooks Box2D and the arenas need go straight to the host here.
+namespace
+{
+void* HostRealloc(void* ptr, size_t size)
+{
+    if (0 == size)
+    {
+        std::free(ptr);
+        return nullptr;
+    }
+
+    return std::realloc(ptr, size);
+}
+
+void HostLogToConsole(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    pd::logToConsoleVaList(format, args);
+    va_end(args);
+}
+} // namespace
+
+decltype(playdate_sys::realloc) pd::realloc = &HostRealloc;
+decltype(playdate_sys::logToConsole) pd::logToConsole = &HostLogToConsole;
+decltype(playdate_sys::error) pd::error = &HostLogToConsole;
+
+clg::size_class_allocator* b2_allocator = nullptr;
+
+void* b2Alloc(int32 size)
+{
+    return std::malloc(size);
+}
+
+void b2Free(void* mem)
+{
+    std::free(mem);
+}
+
+void pd::logToConsoleVaList(const char* format, va_list args)
+{
+    std::vfprintf(stderr, format, args);
+    std::fputc('\n', stderr);
+}
+
+constexpr float FixedDeltaTime = 0.02f; // as the game's fixed update
+constexpr int VelocityIterations = 8;
+constexpr int PositionIterations = 3;
+constexpr float HundredKphInMetersPerSecond = 100.0f / 3.6f;
+constexpr size_t WorkerArenaSize = 64u * 1024u; // a one car vehicle_system at a time
+
+// the values swept; every combination is run
+constexpr float BackTireMaxDriveForces[] = { 450.0f, 601.0f, 750.0f };
+constexpr float FrontTireMaxDriveForces[] = { 250.0f, 331.0f, 420.0f };
+constexpr float FrictionScales[] = { 0.8f, 1.0f, 1.2f };
+constexpr float SteeringRates[] = { 320.0f, 640.0f, 960.0f };
+
+constexpr int TuningCount =
+    clg::array_count(BackTireMaxDriveForces) * clg::array_count(FrontTireMaxDriveForces) *
+    clg::array_count(FrictionScales) * clg::array_count(SteeringRates);
+
+constexpr int Up = static_cast<int>(clg::Tire::ControlState::Up);
+constexpr int Left = static_cast<int>(clg::Tire::ControlState::Left);
+constexpr int Right = static_cast<int>(clg::Tire::ControlState::Right);
+
+// hold a control for a while
+struct ScriptStep
+{
+    float duration; // seconds
+    int control;    // Tire::ControlState bits
+};
+
+struct Maneuver
+{
+    const char* name;
+    const ScriptStep* pSteps;
+    int stepCount;
+};
+
+constexpr ScriptStep LaunchScript[] = { { 20.0f, Up } };
+constexpr ScriptStep StepSteerScript[] = { { 5.0f, Up }, { 6.0f, Up | Right } };
+constexpr ScriptStep SlalomScript[] =
+{
+    { 3.0f, Up },
+    { 1.0f, Up | Left }, { 1.0f, Up | Right }, { 1.0f, Up | Left }, { 1.0f, Up | Right },
+    { 1.0f, Up | Left }, { 1.0f, Up | Right }, { 1.0f, Up | Left }, { 1.0f, Up | Right },
+    { 2.0f, 0 }
+};
+
+constexpr Maneuver Maneuvers[] =
+{
+    { "launch", LaunchScript, clg::array_count(LaunchScript) },
+    { "step_steer", StepSteerScript, clg::array_count(StepSteerScript) },
+    { "slalom", SlalomScript, clg::array_count(SlalomScript) },
+};
+
+constexpr int JobCount = TuningCount * clg::array_count(Maneuvers);
+
+struct Result
+{
+    float topSpeed;                 // m/s
+    float timeTo100Kph;             // seconds; negative when it wasn't reached
+    float skidOnsetTime;            // seconds until the first tire slid; negative when none did
+    float skidOnsetSpeed;           // m/s
+    float maxLateralAcceleration;   // m/s2
+    float distance;                 // m traveled
+};
+
+clg::Car::Tuning GetTuning(int tuningIndex)
+{
+    clg::Car::Tuning tuning;
+    tuning.steeringRate = SteeringRates[tuningIndex % clg::array_count(SteeringRates)];
+    tuningIndex /= clg::array_count(SteeringRates);
+    tuning.frictionScale = FrictionScales[tuningIndex % clg::array_count(FrictionScales)];
+    tuningIndex /= clg::array_count(FrictionScales);
+    tuning.frontTireMaxDriveForce = FrontTireMaxDriveForces[tuningIndex % clg::array_count(FrontTireMaxDriveForces)];
+    tuningIndex /= clg::array_count(FrontTireMaxDriveForces);
+    tuning.backTireMaxDriveForce = BackTireMaxDriveForces[tuningIndex];
+    return tuning;
+}
+
+// the vehicle_system takes its buffers from the worker's arena and gives them back on return
+Result RunManeuver(clg::memory_arena& arena, const clg::Car::Tuning& tuning, const Maneuver& maneuver)
+{
+    b2World world(b2Vec2(0.0f, 0.0f));
+    clg::Car car;
+    car.Create(world, b2Vec2(0.0f, 0.0f), tuning);
+
+    const auto arenaMarker = arena.get_marker();
+    clg::vehicle_system vehicles;
+    if (!vehicles.initialize(arena, 1))
+    {
+        std::cerr << "ERROR: failed to allocate memory for the vehicle system\n";
+        std::exit(1);
+    }
+
+    const auto carIndex = vehicles.add(&car);
+
+    Result result = { 0.0f, -1.0f, -1.0f, 0.0f, 0.0f, 0.0f };
+    int tick = 0;
+    for (int stepIndex = 0; stepIndex < maneuver.stepCount; stepIndex++)
+    {
+        const auto& step = maneuver.pSteps[stepIndex];
+        const auto tickCount = static_cast<int>(step.duration / FixedDeltaTime + 0.5f);
+        for (int i = 0; i < tickCount; i++, tick++)
+        {
+            const auto previousPosition = car.m_body->GetPosition();
+            vehicles.set_control(carIndex, static_cast<clg::Tire::ControlState>(step.control));
+            vehicles.update(FixedDeltaTime);
+            world.Step(FixedDeltaTime, VelocityIterations, PositionIterations);
+
+            const auto time = (tick + 1) * FixedDeltaTime;
+            const auto speed = car.m_body->GetLinearVelocity().Length();
+            result.topSpeed = std::max(result.topSpeed, speed);
+            result.distance += (car.m_body->GetPosition() - previousPosition).Length();
+            if (result.timeTo100Kph < 0.0f && speed >= HundredKphInMetersPerSecond)
+            {
+                result.timeTo100Kph = time;
+            }
+
+            // steady state cornering: v * yaw rate
+            result.maxLateralAcceleration = std::max(result.maxLateralAcceleration, std::abs(speed * car.m_body->GetAngularVelocity()));
+
+            if (result.skidOnsetTime < 0.0f)
+            {
+                for (const auto& tire : car.m_tires)
+                {
+                    if (tire.IsSkidding)
+                    {
+                        result.skidOnsetTime = time;
+                        result.skidOnsetSpeed = speed;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    arena.rewind(arenaMarker);
+    return result;
+}
+
+// A worker's share of the jobs. The owner takes from the back, and workers that run out steal from the
+// front, so the cost of the maneuvers evens out however the jobs were dealt.
+class JobQueue
+{
+public:
+    void Push(int job)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(job);
+    }
+
+    bool Pop(int& job)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_jobs.empty())
+        {
+            return false;
+        }
+
+        job = m_jobs.back();
+        m_jobs.pop_back();
+        return true;
+    }
+
+    bool Steal(int& job)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_jobs.empty())
+        {
+            return false;
+        }
+
+        job = m_jobs.front();
+        m_jobs.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::deque<int> m_jobs;
+};
+
+std::atomic<int> stealCount(0);
+
+// NOTE: Jobs are never added once the workers start, so a worker that finds every queue empty is done.
+bool TakeJob(std::vector<JobQueue>& queues, int workerIndex, int& job)
+{
+    if (queues[workerIndex].Pop(job))
+    {
+        return true;
+    }
+
+    const auto workerCount = static_cast<int>(queues.size());
+    for (int i = 1; i < workerCount; i++)
+    {
+        if (queues[(workerIndex + i) % workerCount].Steal(job))
+        {
+            stealCount++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Worker(std::vector<JobQueue>& queues, int workerIndex, std::vector<Result>& results)
+{
+    clg::memory_arena arena;
+    if (0 == arena.initialize(WorkerArenaSize))
+    {
+        std::cerr << "ERROR: failed to create worker " << workerIndex << "'s arena\n";
+        std::exit(1);
+    }
+
+    int job;
+    while (TakeJob(queues, workerIndex, job))
+    {
+        const auto tuning = GetTuning(job / clg::array_count(Maneuvers));
+        results[job] = RunManeuver(arena, tuning, Maneuvers[job % clg::array_count(Maneuvers)]);
+    }
+}
+
+void WriteCsv(std::ostream& out, const std::vector<Result>& results)
+{
+    out << "maneuver,back_tire_max_drive_force,front_tire_max_drive_force,friction_scale,steering_rate,"
+        "top_speed,time_to_100kph,skid_onset_time,skid_onset_speed,max_lateral_acceleration,distance\n";
+    for (int job = 0; job < JobCount; job++)
+    {
+        const auto tuning = GetTuning(job / clg::array_count(Maneuvers));
+        const auto& result = results[job];
+        out << Maneuvers[job % clg::array_count(Maneuvers)].name << ','
+            << tuning.backTireMaxDriveForce << ','
+            << tuning.frontTireMaxDriveForce << ','
+            << tuning.frictionScale << ','
+            << tuning.steeringRate << ','
+            << result.topSpeed << ','
+            << result.timeTo100Kph << ','
+            << result.skidOnsetTime << ','
+            << result.skidOnsetSpeed << ','
+            << result.maxLateralAcceleration << ','
+            << result.distance << '\n';
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace std;
+
+    const char* outputPath = argc > 1 ? argv[1] : "tuning_sweep.csv";
+    auto workerCount = argc > 2 ? atoi(argv[2]) : static_cast<int>(thread::hardware_concurrency());
+    workerCount = std::clamp(workerCount, 1, JobCount);
+
+    // deal the jobs out in contiguous blocks; stealing takes care of the uneven ones
+    vector<JobQueue> queues(workerCount);
+    for (int job = 0; job < JobCount; job++)
+    {
+        queues[static_cast<int64_t>(job) * workerCount / JobCount].Push(job);
+    }
+
+    vector<Result> results(JobCount);
+    const auto start = chrono::steady_clock::now();
+    // NOTE: Box2D counts its GJK and TOI calls in plain globals (b2_gjkCalls, b2_gjkIters, b2_toiCalls,
+    //  b2_toiIters, b2_toiTime and their maxima) that every world updates, so the workers race on them.
+    //  Nothing here reads them and the worlds' results don't depend on them, but a thread sanitizer will
+    //  report them; ignore those or give each worker its own process.
+    vector<thread> workers;
+    for (int i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(Worker, ref(queues), i, ref(results));
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ofstream out(outputPath);
+    if (!out)
+    {
+        cerr << "ERROR: failed to open " << outputPath << "\n";
+        return 1;
+    }
+
+    WriteCsv(out, results);
+
+    cout << JobCount << " runs (" << TuningCount << " tunings x " << clg::array_count(Maneuvers) << " maneuvers) on "
+        << workerCount << " threads in " << elapsed << "s, " << stealCount << " stolen; wrote " << outputPath << "\n";
+    return 0;
+}